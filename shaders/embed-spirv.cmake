@@ -0,0 +1,37 @@
+# Turns a SPIR-V file into a header with the same words in a constexpr array, so that the
+# shaders can be built into the executable instead of being read at runtime.
+#
+# Usage: cmake -DINPUT=<file.spv> -DOUTPUT=<header.hpp> -DNAME=<variable name> -P embed-spirv.cmake
+
+file(READ ${INPUT} SPIRV_HEX HEX)
+string(LENGTH "${SPIRV_HEX}" SPIRV_HEX_LENGTH)
+
+# Two hex digits per byte, four bytes per word.
+math(EXPR SPIRV_REMAINDER "${SPIRV_HEX_LENGTH} % 8")
+if (SPIRV_HEX_LENGTH EQUAL 0 OR NOT SPIRV_REMAINDER EQUAL 0)
+    message(FATAL_ERROR "${INPUT} isn't a whole number of 32-bit words, so it can't be SPIR-V.")
+endif()
+
+math(EXPR SPIRV_WORD_COUNT "${SPIRV_HEX_LENGTH} / 8")
+
+# glslc writes the words in little endian, so the bytes of each one have to be flipped
+# around to get the actual value.
+string(REGEX REPLACE "(..)(..)(..)(..)" "        0x\\4\\3\\2\\1,\n" SPIRV_WORDS "${SPIRV_HEX}")
+
+get_filename_component(SPIRV_FILE_NAME ${INPUT} NAME)
+
+file(WRITE ${OUTPUT}
+"// Generated from ${SPIRV_FILE_NAME} by embed-spirv.cmake, don't edit this.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace pooper_cube::shaders {
+    alignas(uint32_t) inline constexpr std::array<uint32_t, ${SPIRV_WORD_COUNT}> ${NAME} {
+${SPIRV_WORDS}    };
+
+    static_assert(${NAME}[0] == 0x07230203, \"${SPIRV_FILE_NAME} doesn't start with the SPIR-V magic number.\");
+}
+")
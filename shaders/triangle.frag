@@ -1,9 +1,19 @@
 #version 450
 
+layout (location = 0) in vec4 v_color;
+
 layout (location = 0) out vec4 out_color;
 
+// Set through a specialization constant when the pipeline is built, so the branch that
+// isn't taken gets compiled out entirely.
+layout (constant_id = 0) const bool animate_color = true;
+
 #include "triangle.glsl"
 
 void main() {
-    out_color = vec4(uniform_buffer.color_offset, 1.0, push_constants.color_offset, 1.0);
+    if (animate_color) {
+        out_color = vec4(uniform_buffer.color_offset, 1.0, push_constants.color_offset, 1.0) * v_color;
+    } else {
+        out_color = v_color;
+    }
 }
@@ -1,6 +1,13 @@
 layout (push_constant) uniform push_constants_t {
     mat4 model;
     float color_offset;
+
+    // Which storage buffer of the bindless table the instances get read out of.
+    uint instance_buffer;
+
+    // With CPU culling, another one with the index of the instance behind every drawn one.
+    // All ones otherwise.
+    uint instance_index_buffer;
 } push_constants;
 
 layout (binding = 0) uniform uniform_buffer_t {
@@ -1,9 +1,39 @@
 #version 450
 
+#extension GL_EXT_nonuniform_qualifier : require
+
 layout (location = 0) in vec3 a_position;
 
+layout (location = 0) out vec4 v_color;
+
 #include "triangle.glsl"
 
+struct instance_t {
+    mat4 model;
+    vec4 color;
+};
+
+// The instances are read straight out of whichever buffer has them this frame (the one
+// that the culling or animation shaders wrote, for example), instead of going through
+// vertex attributes.
+layout (std430, set = 1, binding = 0) readonly buffer instances_t {
+    instance_t instances[];
+} instance_buffers[];
+
+// Aliases the same bindings, for the lists of cubes that survived CPU culling.
+layout (std430, set = 1, binding = 0) readonly buffer instance_indices_t {
+    uint indices[];
+} instance_index_buffers[];
+
+const uint no_instance_indices = 0xffffffffu;
+
 void main() {
-    gl_Position = uniform_buffer.projection * uniform_buffer.view * push_constants.model * vec4(a_position, 1.0);
+    const uint instance_index = push_constants.instance_index_buffer == no_instance_indices
+        ? uint(gl_InstanceIndex)
+        : instance_index_buffers[push_constants.instance_index_buffer].indices[gl_InstanceIndex];
+
+    const instance_t instance = instance_buffers[push_constants.instance_buffer].instances[instance_index];
+
+    gl_Position = uniform_buffer.projection * uniform_buffer.view * push_constants.model * instance.model * vec4(a_position, 1.0);
+    v_color = instance.color;
 }
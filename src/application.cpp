@@ -0,0 +1,775 @@
+#include <charconv>
+#include <csignal>
+
+#include "application.hpp"
+#include "deletion-queue.hpp"
+#include "devices.hpp"
+#include "file-watcher.hpp"
+#include "frame-pacing.hpp"
+#include "frames.hpp"
+#include "images.hpp"
+#include "memory.hpp"
+#include "pipeline-cache.hpp"
+#include "profiler.hpp"
+#include "submissions.hpp"
+#include "swapchain.hpp"
+#include "uploads.hpp"
+
+using pooper_cube::allocator_t;
+using pooper_cube::choose_physical_device;
+using pooper_cube::deletion_queue_t;
+using pooper_cube::device_t;
+using pooper_cube::file_watcher_t;
+using pooper_cube::frame_limiter_t;
+using pooper_cube::frame_pacing_t;
+using pooper_cube::framebuffers_t;
+using pooper_cube::generic_vulkan_exception_t;
+using pooper_cube::gpu_profiler_t;
+using pooper_cube::image_t;
+using pooper_cube::instance_bvh_t;
+using pooper_cube::job_system_t;
+using pooper_cube::no_adequate_physical_device_exception_t;
+using pooper_cube::options_t;
+using pooper_cube::physical_device_t;
+using pooper_cube::pipeline_cache_t;
+using pooper_cube::queue_kind_t;
+using pooper_cube::render_pass_t;
+using pooper_cube::renderer_t;
+using pooper_cube::semaphore_t;
+using pooper_cube::semaphore_wait_t;
+using pooper_cube::submission_tracker_t;
+using pooper_cube::swapchain_t;
+using pooper_cube::transform_store_t;
+using pooper_cube::upload_manager_t;
+using pooper_cube::vulkan_creation_exception_t;
+using pooper_cube::window_t;
+
+namespace {
+
+    auto get_device_name(const physical_device_t& p_physical_device) -> std::string {
+        VkPhysicalDeviceProperties device_properties;
+        vkGetPhysicalDeviceProperties(p_physical_device, &device_properties);
+
+        return device_properties.deviceName;
+    }
+
+    auto print_device_name(const physical_device_t& p_physical_device) -> void {
+        fmt::print(stderr, "[INFO]: Selected the {} graphics card.\n", get_device_name(p_physical_device));
+    }
+
+    auto print_worker_count(const job_system_t& p_jobs) -> void {
+        fmt::print(stderr, "[INFO]: Running jobs on {} worker threads and the main thread.\n", p_jobs.get_worker_count());
+    }
+
+    auto print_animation(renderer_t::animation_t p_animation) -> void {
+        if (p_animation == renderer_t::animation_t::cpu) {
+            fmt::print(stderr, "[INFO]: Animating the cubes on the CPU, with the {} kernel.\n", transform_store_t::get_kernel_name());
+        } else if (p_animation == renderer_t::animation_t::gpu) {
+            fmt::print(stderr, "[INFO]: Animating the cubes with a compute shader.\n");
+        }
+    }
+
+    auto print_culling(const options_t& p_options) -> void {
+        if (p_options.cpu_culling && p_options.gpu_culling) {
+            fmt::print(stderr, fmt::fg(fmt::color::yellow), "[WARNING]: --cpu-culling is ignored with --gpu-culling.\n");
+        } else if (p_options.cpu_culling) {
+            fmt::print(stderr, "[INFO]: Culling the cubes on the CPU, with the {} kernel.\n", instance_bvh_t::get_kernel_name());
+        }
+    }
+
+    auto print_render_path(const device_t& p_device) -> void {
+        fmt::print(stderr, "[INFO]: Rendering {}.\n", p_device.has_dynamic_rendering() ? "with dynamic rendering" : "with a render pass");
+        fmt::print(stderr, "[INFO]: {}.\n", p_device.has_push_descriptors() ? "Pushing descriptors" : "Binding descriptors with dynamic offsets");
+    }
+
+    // Everything that has to be made again when the swap chain is replaced. Destroyed in
+    // reverse, so the framebuffers go before the images that they point at. Without a
+    // render pass (i.e. with dynamic rendering), there are no framebuffers at all.
+    //
+    // Every image gets a semaphore of its own for presenting to wait on. Waiting for a frame
+    // only covers its rendering, not the present after it, so a semaphore per frame could be
+    // signaled again while an earlier present is still waiting on it. The image can't be
+    // acquired again until that present is done with it, though.
+    struct presentation_t {
+        presentation_t(std::unique_ptr<swapchain_t> p_swapchain, allocator_t& p_allocator, const render_pass_t* p_render_pass) :
+            swapchain(std::move(p_swapchain)),
+            depth_buffer(p_allocator, swapchain->get_extent().width, swapchain->get_extent().height, image_t::type_t::depth_buffer),
+            framebuffers(
+                p_render_pass != nullptr
+                    ? framebuffers_t{p_allocator.get_device(), *swapchain, depth_buffer, *p_render_pass}
+                    : framebuffers_t{p_allocator.get_device()}
+            )
+        {
+            for (uint32_t i = 0; i < swapchain->get_image_count(); i++) {
+                rendering_done_semaphores.push_back(std::make_unique<semaphore_t>(p_allocator.get_device()));
+            }
+        }
+
+        NO_COPY(presentation_t);
+
+        auto get_target(uint32_t p_image_index) const -> renderer_t::render_target_t {
+            return renderer_t::render_target_t {
+                .framebuffer = framebuffers.is_empty() ? VK_NULL_HANDLE : framebuffers.get(p_image_index),
+                .color_image = swapchain->get_image(p_image_index),
+                .color_view = swapchain->get_image_view(p_image_index),
+                .depth_image = depth_buffer,
+                .depth_view = depth_buffer.get_view(),
+                .extent = swapchain->get_extent(),
+            };
+        }
+
+        std::unique_ptr<swapchain_t> swapchain;
+        image_t depth_buffer;
+        framebuffers_t framebuffers;
+        std::vector<std::unique_ptr<semaphore_t>> rendering_done_semaphores;
+    };
+
+    // Everything that reads what the renderer uploads: the mesh and instances are read by
+    // the vertex input and the vertex shader, and the instances by the compute shaders.
+    constexpr VkPipelineStageFlags upload_wait_stages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+    // Averages what the renderer measured on the CPU over the frames since the last report,
+    // so that it can be printed along with the frame rate.
+    struct cpu_timings_t {
+        struct timing_t {
+            std::string_view name;
+            double sum;
+            uint32_t count;
+
+            auto add(std::optional<double> p_time) noexcept -> void {
+                if (p_time.has_value()) {
+                    sum += p_time.value();
+                    count++;
+                }
+            }
+        };
+
+        auto add(const renderer_t& p_renderer) noexcept -> void {
+            transform_update.add(p_renderer.get_transform_update_time());
+            cpu_culling.add(p_renderer.get_cpu_culling_time());
+        }
+
+        // Something like "transform updates 0.512 ms", or nothing if none of them were
+        // measured. Starts over afterwards.
+        auto take_summary() -> std::string {
+            std::string summary;
+
+            for (auto* timing : {&transform_update, &cpu_culling}) {
+                if (timing->count == 0) {
+                    continue;
+                }
+
+                summary += fmt::format("{}{} {:.3f} ms", summary.empty() ? "" : ", ", timing->name, timing->sum / timing->count);
+                timing->sum = 0.0;
+                timing->count = 0;
+            }
+
+            return summary;
+        }
+
+        timing_t transform_update{"transform updates", 0.0, 0};
+        timing_t cpu_culling{"culling", 0.0, 0};
+    };
+
+    // This is mostly here to see how much the pipeline cache saves us.
+    auto print_time_to_first_frame(std::chrono::steady_clock::time_point p_start_time, const pipeline_cache_t& p_pipeline_cache) -> void {
+        const auto time_to_first_frame = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - p_start_time).count();
+
+        fmt::print(
+            stderr,
+            "[INFO]: Time to first frame: {:.1f} ms ({} pipeline cache).\n",
+            time_to_first_frame,
+            p_pipeline_cache.was_loaded() ? "warm" : "cold"
+        );
+    }
+
+    // Set from the SIGINT handler, since there is no window that could be closed when
+    // running headless.
+    volatile std::sig_atomic_t headless_stop_requested = 0;
+
+    // Catches SIGINT for as long as a headless run lasts, and puts back whatever handled it
+    // before afterwards, so that the next run (in the bench, say) starts out fresh.
+    class headless_interrupt_handler_t {
+        public:
+            headless_interrupt_handler_t() : m_previous_handler(std::signal(SIGINT, [](int) { headless_stop_requested = 1; })) {
+                headless_stop_requested = 0;
+            }
+
+            NO_COPY(headless_interrupt_handler_t);
+
+            auto was_interrupted() const noexcept -> bool { return headless_stop_requested != 0; }
+
+            ~headless_interrupt_handler_t() noexcept {
+                std::signal(SIGINT, m_previous_handler == SIG_ERR ? SIG_DFL : m_previous_handler);
+            }
+
+        private:
+            using handler_t = void (*)(int);
+
+            handler_t m_previous_handler;
+    };
+}
+
+auto pooper_cube::get_renderer_settings(const options_t& p_options) -> renderer_t::settings_t {
+    return renderer_t::settings_t {
+        .frames_in_flight = p_options.frames_in_flight,
+        .cube_count = p_options.cube_count,
+        .nested_cubes = p_options.nested_cubes,
+        .gpu_culling = p_options.gpu_culling,
+        .cpu_culling = p_options.cpu_culling,
+        .cubes_per_draw = p_options.cubes_per_draw,
+        .recording_threads = p_options.recording_threads,
+        .animation = p_options.animation,
+    };
+}
+
+auto pooper_cube::parse_unsigned(std::string_view p_text) -> std::optional<uint32_t> {
+    uint32_t value;
+    const auto [end, error] = std::from_chars(p_text.data(), p_text.data() + p_text.size(), value);
+
+    if (error != std::errc{} || end != p_text.data() + p_text.size()) {
+        return std::optional<uint32_t>{};
+    }
+
+    return value;
+}
+
+auto pooper_cube::parse_extent(std::string_view p_text) -> std::optional<VkExtent2D> {
+    const auto separator = p_text.find('x');
+    if (separator == std::string_view::npos) {
+        return std::optional<VkExtent2D>{};
+    }
+
+    const auto width = parse_unsigned(p_text.substr(0, separator));
+    const auto height = parse_unsigned(p_text.substr(separator + 1));
+
+    if (!width.has_value() || !height.has_value() || width.value() == 0 || height.value() == 0) {
+        return std::optional<VkExtent2D>{};
+    }
+
+    return VkExtent2D{width.value(), height.value()};
+}
+
+auto pooper_cube::parse_animation(std::string_view p_text) -> std::optional<renderer_t::animation_t> {
+    if (p_text == "none") {
+        return renderer_t::animation_t::none;
+    }
+
+    if (p_text == "cpu") {
+        return renderer_t::animation_t::cpu;
+    }
+
+    if (p_text == "gpu") {
+        return renderer_t::animation_t::gpu;
+    }
+
+    return std::optional<renderer_t::animation_t>{};
+}
+
+auto pooper_cube::get_animation_name(renderer_t::animation_t p_animation) -> std::string_view {
+    switch (p_animation) {
+        case renderer_t::animation_t::none:
+            return "none";
+        case renderer_t::animation_t::cpu:
+            return "cpu";
+        case renderer_t::animation_t::gpu:
+            return "gpu";
+    }
+
+    return "unknown";
+}
+
+auto pooper_cube::run_windowed(
+    const instance_t& p_instance,
+    window_t& p_window,
+    const options_t& p_options,
+    std::chrono::steady_clock::time_point p_start_time
+) -> void {
+    const auto window_surface = p_window.create_vulkan_surface(p_instance);
+
+    const auto physical_device = choose_physical_device(p_instance, window_surface);
+    print_device_name(physical_device);
+
+    const device_t logical_device{physical_device, p_options.dynamic_rendering, p_options.push_descriptors};
+    print_render_path(logical_device);
+
+    allocator_t allocator{physical_device, logical_device};
+    submission_tracker_t submissions{logical_device};
+    upload_manager_t uploads{allocator, submissions};
+
+    job_system_t jobs{p_options.worker_threads.value_or(job_system_t::get_default_worker_count()), p_options.pin_threads};
+    print_worker_count(jobs);
+    print_animation(p_options.animation);
+    print_culling(p_options);
+    const pipeline_cache_t pipeline_cache{physical_device, logical_device, p_options.pipeline_cache_path};
+
+    std::optional<gpu_profiler_t> profiler;
+    if (p_options.profile) {
+        profiler.emplace(physical_device, logical_device, p_options.frames_in_flight, p_options.profile_csv_path);
+    }
+
+    // Picked so that a window being dragged around doesn't get a new swap chain every
+    // frame, while one that was just maximized doesn't look stretched for too long.
+    constexpr auto resize_settle_time = std::chrono::milliseconds{100};
+
+    // How long to sleep for at a time while there's nothing to render, in seconds.
+    constexpr double idle_wait_time = 0.25;
+
+    auto swapchain = std::make_unique<swapchain_t>(p_window, physical_device, logical_device, window_surface, p_options.swapchain);
+    const auto color_format = swapchain->get_format();
+
+    renderer_t renderer{physical_device, logical_device, allocator, submissions, uploads, jobs, pipeline_cache, color_format, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, get_renderer_settings(p_options), profiler.has_value() ? &profiler.value() : nullptr};
+    const auto render_pass = renderer.get_render_pass();
+    auto& frames = renderer.get_frames();
+
+    auto presentation = std::make_unique<presentation_t>(std::move(swapchain), allocator, render_pass);
+
+    // The frames that are still in flight keep using the old swap chain (and its depth
+    // buffer and framebuffers) for a while after it has been replaced.
+    deletion_queue_t retired{submissions, frames.size()};
+
+    // Returns false while the window is minimized, since there's nothing to create a swap
+    // chain for in that case.
+    const auto recreate_presentation = [&]() -> bool {
+        const auto [width, height] = p_window.get_framebuffer_dimensions();
+        if (width == 0 || height == 0) {
+            return false;
+        }
+
+        auto new_swapchain = std::make_unique<swapchain_t>(p_window, physical_device, logical_device, window_surface, p_options.swapchain, *presentation->swapchain);
+        auto new_presentation = std::make_unique<presentation_t>(std::move(new_swapchain), allocator, render_pass);
+
+        retired.defer(std::move(presentation), submissions.get_last_submission(queue_kind_t::graphics));
+        presentation = std::move(new_presentation);
+
+        return true;
+    };
+
+    fmt::print(stderr, "[INFO]: Rendering {} cube(s) with {} frame(s) in flight.\n", p_options.cube_count, frames.size());
+    fmt::print(
+        stderr,
+        "[INFO]: Presenting with the {} present mode and {} swap chain images.\n",
+        get_present_mode_name(presentation->swapchain->get_present_mode()),
+        presentation->swapchain->get_image_count()
+    );
+
+    std::optional<frame_limiter_t> limiter;
+    if (p_options.frame_rate_limit.has_value()) {
+        limiter.emplace(p_options.frame_rate_limit.value());
+    }
+
+    frame_pacing_t pacing;
+
+    // Relative to the working directory, same as where the shaders get loaded from.
+    std::optional<file_watcher_t> shader_watcher;
+    if (p_options.hot_reload) {
+        shader_watcher.emplace("shaders");
+        fmt::print(stderr, "[INFO]: Watching the shaders for changes.\n");
+    }
+
+    bool first_frame = true;
+    bool suboptimal = false;
+
+    cpu_timings_t cpu_timings;
+    auto report_time = std::chrono::steady_clock::now();
+
+    p_window.show();
+    while (!p_window.should_close()) {
+        // Nothing can be seen while the window is minimized, so instead of rendering, we
+        // sleep until something happens (or a little while has passed). The frames that
+        // are still in flight just finish on their own, and get waited for as usual once
+        // rendering picks up again.
+        const auto [framebuffer_width, framebuffer_height] = p_window.get_framebuffer_dimensions();
+        if (p_window.is_iconified() || framebuffer_width == 0 || framebuffer_height == 0) {
+            pacing.pause();
+            p_window.wait_events(idle_wait_time);
+            continue;
+        }
+
+        // A window without the focus may well still be visible, so it keeps rendering, just
+        // a lot more slowly. Events cut the wait short, so this is only roughly the
+        // background frame rate.
+        if (!p_window.is_focused()) {
+            pacing.pause();
+
+            if (p_options.background_frame_rate == 0) {
+                p_window.wait_events(idle_wait_time);
+                continue;
+            }
+
+            p_window.wait_events(1.0 / static_cast<double>(p_options.background_frame_rate));
+        }
+
+        // Before anything else, so that the frame is as fresh as it can be once it's done.
+        if (limiter.has_value()) {
+            limiter->wait();
+        }
+
+        pacing.mark_frame();
+
+        auto& frame = frames.current();
+        const std::array<VkCommandBuffer, 1> command_buffers{frame.get_command_buffer()};
+        const auto frame_time = glfwGetTime();
+
+        // Only the frame that we are about to reuse has to be finished. The other
+        // frames in the ring can keep the GPU busy in the meantime.
+        frame.wait();
+        retired.collect();
+
+        uint32_t image_index;
+
+        auto result = vkAcquireNextImageKHR(logical_device, *presentation->swapchain, std::numeric_limits<uint64_t>::max(), frame.get_acquired_image_semaphore(), VK_NULL_HANDLE, &image_index);
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+            // There's no way around a new swap chain in this case, resizing or not. If the
+            // window just got minimized, the next time around the loop takes care of it.
+            if (recreate_presentation()) {
+                suboptimal = false;
+            }
+
+            continue;
+        } else if (result == VK_SUBOPTIMAL_KHR) {
+            suboptimal = true;
+        } else if (result != VK_SUCCESS) {
+            throw generic_vulkan_exception_t{result, "Failed to retrieve an image from the swap chain."};
+        }
+
+        frame.reset();
+
+        renderer.record(frame, presentation->get_target(image_index), frame_time);
+
+        const VkSemaphore rendering_done_semaphore_raw = *presentation->rendering_done_semaphores[image_index];
+
+        // The swap chain hands out binary semaphores, so that's what presenting has to
+        // wait on as well. The frame itself is tracked with the graphics queue's timeline.
+        std::vector<semaphore_wait_t> waits {
+            semaphore_wait_t{frame.get_acquired_image_semaphore(), 0, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT},
+        };
+
+        const auto upload_wait = renderer.get_upload_wait();
+        if (upload_wait.has_value()) {
+            waits.push_back(submissions.get_wait(upload_wait.value(), upload_wait_stages));
+        }
+
+        const std::array<VkSemaphore, 1> signals{rendering_done_semaphore_raw};
+
+        frame.set_submission(submissions.submit(queue_kind_t::graphics, command_buffers, waits, signals));
+
+        const VkSwapchainKHR swapchain_raw = *presentation->swapchain;
+
+        const VkPresentInfoKHR present_info {
+            .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+            .pNext = nullptr,
+            .waitSemaphoreCount = 1,
+            .pWaitSemaphores = &rendering_done_semaphore_raw,
+            .swapchainCount = 1,
+            .pSwapchains = &swapchain_raw,
+            .pImageIndices = &image_index,
+            .pResults = nullptr,
+        };
+
+        result = vkQueuePresentKHR(logical_device.get_present_queue(), &present_info);
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+            if (recreate_presentation()) {
+                suboptimal = false;
+            }
+        } else if (result == VK_SUBOPTIMAL_KHR) {
+            suboptimal = true;
+        } else if (result != VK_SUCCESS) {
+            throw generic_vulkan_exception_t{result, "Failed to present to the swap chain."};
+        }
+
+        if (first_frame) {
+            print_time_to_first_frame(p_start_time, pipeline_cache);
+            first_frame = false;
+        }
+
+        cpu_timings.add(renderer);
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now - report_time >= std::chrono::seconds{1}) {
+            const auto summary = cpu_timings.take_summary();
+            if (!summary.empty()) {
+                fmt::print(stderr, "[INFO]: Per frame on the CPU: {}.\n", summary);
+            }
+
+            report_time = now;
+        }
+
+        frames.advance();
+        p_window.poll_events();
+
+        if (shader_watcher.has_value()) {
+            const auto changed_files = shader_watcher->poll();
+            const auto spirv_changed = std::any_of(changed_files.begin(), changed_files.end(), [](const std::string& p_name) {
+                return p_name.ends_with(".spv");
+            });
+
+            if (spirv_changed) {
+                renderer.reload_shaders();
+            }
+        }
+
+        // A swap chain that is merely suboptimal (or the wrong size) can still be presented
+        // to, so it's left alone until the window is done changing size.
+        const bool resize_settled = p_window.take_settled_resize(resize_settle_time);
+        if (resize_settled || (suboptimal && !p_window.is_resize_pending())) {
+            if (recreate_presentation()) {
+                suboptimal = false;
+            }
+        }
+    }
+
+    vkDeviceWaitIdle(logical_device);
+
+    if (profiler.has_value()) {
+        profiler->flush();
+    }
+
+    pacing.print_report();
+    allocator.print_statistics();
+}
+
+auto pooper_cube::run_headless(
+    const instance_t& p_instance,
+    const options_t& p_options,
+    std::chrono::steady_clock::time_point p_start_time
+) -> headless_results_t {
+    using clock_t = std::chrono::steady_clock;
+
+    const auto physical_device = choose_physical_device(p_instance);
+    print_device_name(physical_device);
+
+    const device_t logical_device{physical_device, p_options.dynamic_rendering, p_options.push_descriptors};
+    print_render_path(logical_device);
+
+    allocator_t allocator{physical_device, logical_device};
+    submission_tracker_t submissions{logical_device};
+    upload_manager_t uploads{allocator, submissions};
+
+    job_system_t jobs{p_options.worker_threads.value_or(job_system_t::get_default_worker_count()), p_options.pin_threads};
+    print_worker_count(jobs);
+    print_animation(p_options.animation);
+    print_culling(p_options);
+    const pipeline_cache_t pipeline_cache{physical_device, logical_device, p_options.pipeline_cache_path};
+
+    std::optional<gpu_profiler_t> profiler;
+    if (p_options.profile) {
+        // With a fixed number of frames, there's a limit to how many frame times there can be.
+        profiler.emplace(physical_device, logical_device, p_options.frames_in_flight, p_options.profile_csv_path, p_options.frame_count.has_value());
+    }
+
+    const auto extent = p_options.headless_extent.value();
+
+    const image_t color_target{allocator, extent.width, extent.height, image_t::type_t::color_attachment};
+    const image_t depth_buffer{allocator, extent.width, extent.height, image_t::type_t::depth_buffer};
+
+    renderer_t renderer{physical_device, logical_device, allocator, submissions, uploads, jobs, pipeline_cache, color_target.get_format(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, get_renderer_settings(p_options), profiler.has_value() ? &profiler.value() : nullptr};
+    auto& frames = renderer.get_frames();
+
+    const std::array<VkImageView, 1> color_views{color_target.get_view()};
+    const auto render_pass = renderer.get_render_pass();
+    const framebuffers_t framebuffers = render_pass != nullptr
+        ? framebuffers_t{logical_device, color_views, extent, depth_buffer, *render_pass}
+        : framebuffers_t{logical_device};
+
+    const renderer_t::render_target_t target {
+        .framebuffer = render_pass != nullptr ? framebuffers.get(0) : VK_NULL_HANDLE,
+        .color_image = color_target,
+        .color_view = color_target.get_view(),
+        .depth_image = depth_buffer,
+        .depth_view = depth_buffer.get_view(),
+        .extent = extent,
+    };
+
+    fmt::print(
+        stderr,
+        "[INFO]: Rendering {} cube(s) headless at {}x{} with {} frame(s) in flight.\n",
+        p_options.cube_count, extent.width, extent.height, frames.size()
+    );
+
+    const headless_interrupt_handler_t interrupt_handler;
+
+    // With a simulated clock, the frames should be exactly the same on every run, which
+    // they wouldn't be if the first few of them happened to be empty.
+    if (p_options.fixed_time_step.has_value()) {
+        renderer.wait_until_ready();
+    }
+
+    headless_results_t results {
+        .device_name = get_device_name(physical_device),
+        .dynamic_rendering = logical_device.has_dynamic_rendering(),
+        .cpu_frame_times = std::vector<double>{},
+        .gpu_frame_times = std::vector<double>{},
+        .transform_update_times = std::vector<double>{},
+        .cpu_culling_times = std::vector<double>{},
+        .total_time = 0.0,
+        .interrupted = false,
+    };
+
+    if (p_options.frame_count.has_value()) {
+        results.cpu_frame_times.reserve(p_options.frame_count.value());
+    }
+
+    const auto start_time = clock_t::now();
+    auto report_time = start_time;
+    uint64_t frame_count = 0;
+    uint64_t report_frame_count = 0;
+
+    std::optional<frame_limiter_t> limiter;
+    if (p_options.frame_rate_limit.has_value()) {
+        limiter.emplace(p_options.frame_rate_limit.value());
+    }
+
+    frame_pacing_t pacing;
+    cpu_timings_t cpu_timings;
+
+    while (!interrupt_handler.was_interrupted() && (!p_options.frame_count.has_value() || frame_count < p_options.frame_count.value())) {
+        if (limiter.has_value()) {
+            limiter->wait();
+        }
+
+        pacing.mark_frame();
+
+        auto& frame = frames.current();
+        const std::array<VkCommandBuffer, 1> command_buffers{frame.get_command_buffer()};
+        const auto frame_start = clock_t::now();
+        const auto frame_time = p_options.fixed_time_step.has_value()
+            ? static_cast<double>(frame_count) * p_options.fixed_time_step.value()
+            : std::chrono::duration<double>(frame_start - start_time).count();
+
+        frame.wait();
+        frame.reset();
+
+        renderer.record(frame, target, frame_time);
+
+        std::vector<semaphore_wait_t> waits;
+
+        const auto upload_wait = renderer.get_upload_wait();
+        if (upload_wait.has_value()) {
+            waits.push_back(submissions.get_wait(upload_wait.value(), upload_wait_stages));
+        }
+
+        frame.set_submission(submissions.submit(queue_kind_t::graphics, command_buffers, waits));
+
+        if (frame_count == 0) {
+            print_time_to_first_frame(p_start_time, pipeline_cache);
+        }
+
+        frames.advance();
+        frame_count++;
+
+        const auto now = clock_t::now();
+        cpu_timings.add(renderer);
+
+        if (p_options.frame_count.has_value()) {
+            results.cpu_frame_times.push_back(std::chrono::duration<double, std::milli>(now - frame_start).count());
+
+            const auto transform_update_time = renderer.get_transform_update_time();
+            if (transform_update_time.has_value()) {
+                results.transform_update_times.push_back(transform_update_time.value());
+            }
+
+            const auto cpu_culling_time = renderer.get_cpu_culling_time();
+            if (cpu_culling_time.has_value()) {
+                results.cpu_culling_times.push_back(cpu_culling_time.value());
+            }
+        }
+
+        const auto since_report = std::chrono::duration<double>(now - report_time).count();
+        if (since_report >= 1.0) {
+            const auto summary = cpu_timings.take_summary();
+            fmt::print(
+                stderr,
+                "[INFO]: {:.1f} FPS{}\n",
+                static_cast<double>(frame_count - report_frame_count) / since_report,
+                summary.empty() ? "" : fmt::format(" ({} per frame on the CPU)", summary)
+            );
+            report_time = now;
+            report_frame_count = frame_count;
+        }
+    }
+
+    // Nothing gets presented, so everything that the GPU does goes through the tracker.
+    submissions.wait_idle();
+
+    results.total_time = std::chrono::duration<double>(clock_t::now() - start_time).count();
+    results.interrupted = interrupt_handler.was_interrupted();
+    fmt::print(
+        stderr,
+        "[INFO]: Rendered {} frames in {:.3f} seconds ({:.1f} FPS on average).\n",
+        frame_count, results.total_time, static_cast<double>(frame_count) / results.total_time
+    );
+
+    if (profiler.has_value()) {
+        profiler->flush();
+
+        const auto gpu_frame_times = profiler->get_frame_times();
+        results.gpu_frame_times.assign(gpu_frame_times.begin(), gpu_frame_times.end());
+    }
+
+    pacing.print_report();
+    allocator.print_statistics();
+
+    return results;
+}
+
+auto pooper_cube::report_fatal_errors(const std::function<void()>& p_function) -> int {
+    try {
+        p_function();
+    } catch (window_t::creation_exception_t exception) {
+        using exception_t = window_t::creation_exception_t;
+
+        switch (exception) {
+            case exception_t::glfw_init_failed:
+                fmt::print(stderr, fmt::fg(fmt::color::red), ": Failed to initialize GLFW.\n");
+                break;
+            case exception_t::window_creation_failed:
+                fmt::print(stderr, fmt::fg(fmt::color::red), "[FATAL ERROR]: Failed to create the GLFW window.\n");
+                break;
+        }
+
+        return EXIT_FAILURE;
+    } catch (vulkan_creation_exception_t& exception) {
+        fmt::print(
+            stderr,
+            fmt::fg(fmt::color::red),
+            "[FATAL ERROR]: Failed to create a Vulkan {}. Vulkan error {}.\n",
+            exception.object_name,
+            static_cast<int>(exception.error_code)
+        );
+
+        return EXIT_FAILURE;
+    } catch (no_adequate_physical_device_exception_t& exception) {
+        fmt::print(
+            stderr,
+            fmt::fg(fmt::color::red),
+            "[FATAL ERROR]: Could not find an adequate physical device.\n"
+        );
+
+        return EXIT_FAILURE;
+    } catch (allocator_t::allocation_exception_t& exception) {
+        fmt::print(
+            stderr,
+            fmt::fg(fmt::color::red),
+            "[FATAL ERROR]: Could not allocate device memory: {}. Vulkan error {}\n",
+            exception.what, static_cast<int>(exception.error_code)
+        );
+
+        return EXIT_FAILURE;
+    } catch (const pooper_cube::generic_vulkan_exception_t& exception) {
+        fmt::print(
+            stderr,
+            fmt::fg(fmt::color::red),
+            "[VULKAN ERROR {}]: {}\n",
+            static_cast<int>(exception.error_code), exception.what
+        );
+
+        return EXIT_FAILURE;
+    } catch (const pooper_cube::file_opening_exception_t& exception) {
+        fmt::print(stderr, fmt::fg(fmt::color::red), "[FATAL ERROR]: Failed to open the {}.\n", exception.file_name);
+
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
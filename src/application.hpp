@@ -0,0 +1,134 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+
+#include "common.hpp"
+#include "renderer.hpp"
+#include "swapchain.hpp"
+#include "vulkan-instance.hpp"
+#include "window.hpp"
+
+// The parts of the program that both pooper-cube and pooper-cube-bench need, so that the
+// benchmark runs the exact same render loop as the real thing.
+
+namespace pooper_cube {
+    // Everything that can be set from the command line.
+    struct options_t {
+        bool enable_validation;
+        uint32_t frames_in_flight;
+        uint32_t cube_count;
+        bool nested_cubes;
+        bool gpu_culling;
+        uint32_t cubes_per_draw;
+        uint32_t recording_threads;
+
+        // Only set when rendering headless.
+        std::optional<VkExtent2D> headless_extent;
+        std::optional<uint32_t> frame_count;
+
+        // Advances the time by exactly this many seconds every frame, instead of following
+        // the real clock. Only used when rendering headless.
+        std::optional<double> fixed_time_step;
+
+        std::optional<std::filesystem::path> pipeline_cache_path;
+
+        bool profile;
+        std::optional<std::filesystem::path> profile_csv_path;
+
+        // Only used when rendering to a window.
+        swapchain_settings_t swapchain;
+
+        // Caps the frame rate, no matter what the present mode is.
+        std::optional<double> frame_rate_limit;
+
+        // How many frames a second are rendered while the window doesn't have the focus.
+        // Zero stops rendering until it gets the focus back. Only used when rendering to a
+        // window.
+        uint32_t background_frame_rate;
+
+        // Watches the shader directory, and rebuilds the graphics pipeline whenever any of
+        // the SPIR-V in it changes. Only used when rendering to a window.
+        bool hot_reload;
+
+        // Renders without a render pass and framebuffers, if the device supports it.
+        bool dynamic_rendering;
+
+        // Pushes the per-frame descriptors straight into the command buffers, if the
+        // device supports it, instead of allocating sets for them.
+        bool push_descriptors;
+
+        // How many threads the job system gets, on top of the main thread. Defaults to one
+        // less than there are cores.
+        std::optional<uint32_t> worker_threads;
+
+        // Pins each worker thread to a core of its own.
+        bool pin_threads;
+
+        renderer_t::animation_t animation;
+
+        // Ignored with GPU culling.
+        bool cpu_culling;
+    };
+
+    // What a headless run measured.
+    struct headless_results_t {
+        std::string device_name;
+
+        // Whether dynamic rendering was actually used, as opposed to a render pass.
+        bool dynamic_rendering;
+
+        // In milliseconds, from the start of one frame to the start of the next one. Only
+        // collected when the number of frames is fixed.
+        std::vector<double> cpu_frame_times;
+
+        // In milliseconds. Only collected when profiling with a fixed number of frames.
+        std::vector<double> gpu_frame_times;
+
+        // In milliseconds, how long each frame spent updating the transforms of the cubes.
+        // Only collected when they're animated on the CPU, with a fixed number of frames.
+        std::vector<double> transform_update_times;
+
+        // In milliseconds, how long each frame spent culling the cubes on the CPU. Only
+        // collected with CPU culling, with a fixed number of frames.
+        std::vector<double> cpu_culling_times;
+
+        // In seconds.
+        double total_time;
+
+        // Whether the run got stopped with Ctrl-C before it was done.
+        bool interrupted;
+    };
+
+    auto get_renderer_settings(const options_t& p_options) -> renderer_t::settings_t;
+
+    auto parse_unsigned(std::string_view p_text) -> std::optional<uint32_t>;
+
+    // Parses something like "1920x1080".
+    auto parse_extent(std::string_view p_text) -> std::optional<VkExtent2D>;
+
+    // Parses one of "none", "cpu" or "gpu".
+    auto parse_animation(std::string_view p_text) -> std::optional<renderer_t::animation_t>;
+    auto get_animation_name(renderer_t::animation_t p_animation) -> std::string_view;
+
+    auto run_windowed(
+        const instance_t& p_instance,
+        window_t& p_window,
+        const options_t& p_options,
+        std::chrono::steady_clock::time_point p_start_time
+    ) -> void;
+
+    // Renders into offscreen images instead of a swap chain, so that no window system
+    // (or even a display) is required. Runs until the requested number of frames have been
+    // rendered, or until interrupted if there is no frame count.
+    auto run_headless(
+        const instance_t& p_instance,
+        const options_t& p_options,
+        std::chrono::steady_clock::time_point p_start_time
+    ) -> headless_results_t;
+
+    // Calls the function, and turns anything that it throws at us into an error message.
+    // Returns the exit code that the program should end with.
+    auto report_fatal_errors(const std::function<void()>& p_function) -> int;
+}
@@ -0,0 +1,373 @@
+#include <chrono>
+#include <fstream>
+#include <numeric>
+
+#include "application.hpp"
+#include "vulkan-debug.hpp"
+
+// Renders a handful of fixed scenes headless, with a simulated clock, and prints how long
+// they took as JSON. Since the scenes and the animation are exactly the same every time,
+// two builds can be compared by running both on the same machine.
+
+namespace {
+    using pooper_cube::choose_physical_device;
+    using pooper_cube::debug_messenger_t;
+    using pooper_cube::instance_t;
+    using pooper_cube::options_t;
+    using pooper_cube::parse_animation;
+    using pooper_cube::parse_extent;
+    using pooper_cube::parse_unsigned;
+    using pooper_cube::renderer_t;
+
+    struct scene_t {
+        std::string_view name;
+        uint32_t cube_count;
+        bool nested_cubes;
+
+        // Bigger scenes get fewer frames, so that they don't take forever on a software
+        // renderer.
+        uint32_t frame_count;
+    };
+
+    constexpr std::array<scene_t, 4> scenes {
+        scene_t{"one-cube", 1, false, 2000},
+        scene_t{"10k-cubes", 10'000, false, 500},
+        scene_t{"1m-cubes", 1'000'000, false, 50},
+        scene_t{"overdraw", 256, true, 500},
+    };
+
+    // Left out of the results, since they include things like the driver warming up.
+    constexpr uint32_t warm_up_frame_count = 10;
+
+    // The same time step for every scene, as if running at 60 Hz.
+    constexpr double time_step = 1.0 / 60.0;
+
+    struct summary_t {
+        double mean;
+        double min;
+        double p50;
+        double p95;
+        double p99;
+        double max;
+    };
+
+    auto summarize(std::span<const double> p_samples) -> std::optional<summary_t> {
+        if (p_samples.size() <= warm_up_frame_count) {
+            return std::optional<summary_t>{};
+        }
+
+        std::vector<double> sorted(p_samples.begin() + warm_up_frame_count, p_samples.end());
+        std::sort(sorted.begin(), sorted.end());
+
+        const auto percentile = [&](double p_percentile) {
+            return sorted[static_cast<size_t>(p_percentile / 100.0 * static_cast<double>(sorted.size() - 1) + 0.5)];
+        };
+
+        return summary_t {
+            .mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / static_cast<double>(sorted.size()),
+            .min = sorted.front(),
+            .p50 = percentile(50.0),
+            .p95 = percentile(95.0),
+            .p99 = percentile(99.0),
+            .max = sorted.back(),
+        };
+    }
+
+    auto to_json(const std::optional<summary_t>& p_summary) -> std::string {
+        if (!p_summary.has_value()) {
+            return "null";
+        }
+
+        const auto& summary = p_summary.value();
+        return fmt::format(
+            R"({{"mean": {:.4f}, "min": {:.4f}, "p50": {:.4f}, "p95": {:.4f}, "p99": {:.4f}, "max": {:.4f}}})",
+            summary.mean, summary.min, summary.p50, summary.p95, summary.p99, summary.max
+        );
+    }
+
+    // Device names are the only strings that we don't pick ourselves.
+    auto escape_json(std::string_view p_text) -> std::string {
+        std::string escaped;
+
+        for (const auto character : p_text) {
+            if (character == '"' || character == '\\') {
+                escaped += '\\';
+                escaped += character;
+            } else if (static_cast<unsigned char>(character) < 0x20) {
+                escaped += fmt::format("\\u{:04x}", static_cast<unsigned>(character));
+            } else {
+                escaped += character;
+            }
+        }
+
+        return escaped;
+    }
+
+    auto get_render_path_name(bool p_dynamic_rendering) -> std::string_view {
+        return p_dynamic_rendering ? "dynamic-rendering" : "render-pass";
+    }
+
+    auto print_usage() -> void {
+        fmt::print(
+            stderr,
+            "Usage: pooper-cube-bench [--scene NAME]... [--frames N] [--resolution WxH] [--output PATH]\n"
+            "                         [--frames-in-flight N] [--gpu-culling] [--cubes-per-draw N]\n"
+            "                         [--record-threads N] [--enable-validation] [--no-dynamic-rendering]\n"
+            "                         [--no-push-descriptors] [--worker-threads N] [--pin-threads]\n"
+            "                         [--animation MODE] [--cpu-culling]\n"
+            "Scenes:"
+        );
+
+        for (const auto& scene : scenes) {
+            fmt::print(stderr, " {}", scene.name);
+        }
+
+        fmt::print(stderr, "\n");
+    }
+}
+
+auto main(int p_argc, char** p_argv) -> int {
+    const auto start_time = std::chrono::steady_clock::now();
+
+    // The settings that don't change between scenes. Lavapipe is perfectly happy with
+    // this resolution, and it's still big enough for fill rate to matter.
+    options_t base_options {
+        .enable_validation = false,
+        .frames_in_flight = 2,
+        .cube_count = 1,
+        .nested_cubes = false,
+        .gpu_culling = false,
+        .cubes_per_draw = 0,
+        .recording_threads = 1,
+        .headless_extent = VkExtent2D{1280, 720},
+        .frame_count = std::optional<uint32_t>{},
+        .fixed_time_step = time_step,
+        // A warm cache on one run and a cold one on the next would make the startup time
+        // differ, so there's no cache at all.
+        .pipeline_cache_path = std::optional<std::filesystem::path>{},
+        .profile = true,
+        .profile_csv_path = std::optional<std::filesystem::path>{},
+        // Nothing is presented, and the frames should go as fast as they can.
+        .swapchain = pooper_cube::swapchain_settings_t{
+            .present_mode = std::optional<VkPresentModeKHR>{},
+            .image_count = std::optional<uint32_t>{},
+        },
+        .frame_rate_limit = std::optional<double>{},
+        .background_frame_rate = 0,
+        .hot_reload = false,
+        // Each scene gets run once for each of the ways of rendering that the device can
+        // do, so this only decides whether dynamic rendering is one of them.
+        .dynamic_rendering = true,
+        .push_descriptors = true,
+        .worker_threads = std::optional<uint32_t>{},
+        .pin_threads = false,
+        .animation = renderer_t::animation_t::none,
+        .cpu_culling = false,
+    };
+
+    std::vector<scene_t> selected_scenes;
+    std::optional<uint32_t> frame_count;
+    std::optional<std::filesystem::path> output_path;
+
+    const std::vector<const char*> argv(p_argv, p_argv + p_argc);
+
+    // All of the numeric options want a positive integer.
+    const auto parse_positive = [&](size_t& p_i) -> std::optional<uint32_t> {
+        const auto option = argv[p_i];
+        const auto value = p_i + 1 < argv.size() ? parse_unsigned(argv[++p_i]) : std::optional<uint32_t>{};
+        if (!value.has_value() || value.value() == 0) {
+            fmt::print(stderr, fmt::fg(fmt::color::red), "[FATAL ERROR]: {} expects a positive integer.\n", option);
+            return std::optional<uint32_t>{};
+        }
+
+        return value;
+    };
+
+    for (size_t i = 1; i < argv.size(); i++) {
+        if (std::strcmp(argv[i], "--scene") == 0) {
+            const auto name = i + 1 < argv.size() ? std::string_view{argv[++i]} : std::string_view{};
+            const auto scene = std::find_if(scenes.begin(), scenes.end(), [&](const scene_t& p_scene) { return p_scene.name == name; });
+
+            if (scene == scenes.end()) {
+                fmt::print(stderr, fmt::fg(fmt::color::red), "[FATAL ERROR]: Unknown scene \"{}\".\n", name);
+                print_usage();
+                return EXIT_FAILURE;
+            }
+
+            selected_scenes.push_back(*scene);
+        } else if (std::strcmp(argv[i], "--frames") == 0) {
+            frame_count = parse_positive(i);
+            if (!frame_count.has_value()) {
+                return EXIT_FAILURE;
+            }
+        } else if (std::strcmp(argv[i], "--resolution") == 0) {
+            base_options.headless_extent = i + 1 < argv.size() ? parse_extent(argv[++i]) : std::optional<VkExtent2D>{};
+            if (!base_options.headless_extent.has_value()) {
+                fmt::print(stderr, fmt::fg(fmt::color::red), "[FATAL ERROR]: --resolution expects a resolution such as 1280x720.\n");
+                return EXIT_FAILURE;
+            }
+        } else if (std::strcmp(argv[i], "--output") == 0) {
+            if (i + 1 >= argv.size()) {
+                fmt::print(stderr, fmt::fg(fmt::color::red), "[FATAL ERROR]: --output expects a file path.\n");
+                return EXIT_FAILURE;
+            }
+
+            output_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--frames-in-flight") == 0) {
+            const auto value = parse_positive(i);
+            if (!value.has_value()) {
+                return EXIT_FAILURE;
+            }
+
+            base_options.frames_in_flight = value.value();
+        } else if (std::strcmp(argv[i], "--gpu-culling") == 0) {
+            base_options.gpu_culling = true;
+        } else if (std::strcmp(argv[i], "--cubes-per-draw") == 0) {
+            const auto value = parse_positive(i);
+            if (!value.has_value()) {
+                return EXIT_FAILURE;
+            }
+
+            base_options.cubes_per_draw = value.value();
+        } else if (std::strcmp(argv[i], "--record-threads") == 0) {
+            const auto value = parse_positive(i);
+            if (!value.has_value()) {
+                return EXIT_FAILURE;
+            }
+
+            base_options.recording_threads = value.value();
+        } else if (std::strcmp(argv[i], "--enable-validation") == 0) {
+            base_options.enable_validation = true;
+        } else if (std::strcmp(argv[i], "--no-dynamic-rendering") == 0) {
+            base_options.dynamic_rendering = false;
+        } else if (std::strcmp(argv[i], "--no-push-descriptors") == 0) {
+            base_options.push_descriptors = false;
+        } else if (std::strcmp(argv[i], "--worker-threads") == 0) {
+            base_options.worker_threads = i + 1 < argv.size() ? parse_unsigned(argv[++i]) : std::optional<uint32_t>{};
+            if (!base_options.worker_threads.has_value()) {
+                fmt::print(stderr, fmt::fg(fmt::color::red), "[FATAL ERROR]: --worker-threads expects an integer.\n");
+                print_usage();
+                return EXIT_FAILURE;
+            }
+        } else if (std::strcmp(argv[i], "--pin-threads") == 0) {
+            base_options.pin_threads = true;
+        } else if (std::strcmp(argv[i], "--animation") == 0) {
+            const auto animation = i + 1 < argv.size() ? parse_animation(argv[++i]) : std::optional<renderer_t::animation_t>{};
+            if (!animation.has_value()) {
+                fmt::print(stderr, fmt::fg(fmt::color::red), "[FATAL ERROR]: --animation expects one of none, cpu or gpu.\n");
+                print_usage();
+                return EXIT_FAILURE;
+            }
+
+            base_options.animation = animation.value();
+        } else if (std::strcmp(argv[i], "--cpu-culling") == 0) {
+            base_options.cpu_culling = true;
+        } else {
+            fmt::print(stderr, fmt::fg(fmt::color::red), "[FATAL ERROR]: Unknown option \"{}\".\n", argv[i]);
+            print_usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (selected_scenes.empty()) {
+        selected_scenes.assign(scenes.begin(), scenes.end());
+    }
+
+    return pooper_cube::report_fatal_errors([&]() {
+        const instance_t instance{base_options.enable_validation, false};
+        std::optional<debug_messenger_t> debug_messenger;
+
+        if (base_options.enable_validation) {
+            debug_messenger = debug_messenger_t{instance};
+        }
+
+        std::string device_name;
+        std::vector<std::string> scene_results;
+
+        // The render pass always works, so it's the baseline that dynamic rendering gets
+        // compared against.
+        std::vector<bool> render_paths{false};
+        if (base_options.dynamic_rendering && choose_physical_device(instance).supports_dynamic_rendering) {
+            render_paths.push_back(true);
+        }
+
+        bool interrupted = false;
+
+        for (const auto& scene : selected_scenes) {
+            for (const auto dynamic_rendering : render_paths) {
+                fmt::print(stderr, "[INFO]: Running the {} scene ({}).\n", scene.name, get_render_path_name(dynamic_rendering));
+
+                auto options = base_options;
+                options.cube_count = scene.cube_count;
+                options.nested_cubes = scene.nested_cubes;
+                options.frame_count = frame_count.value_or(scene.frame_count) + warm_up_frame_count;
+                options.dynamic_rendering = dynamic_rendering;
+
+                // Every scene gets a device of its own, so that one can't leave anything behind
+                // that slows down the next.
+                const auto results = pooper_cube::run_headless(instance, options, start_time);
+                device_name = results.device_name;
+
+                // Can come up short if the run got interrupted.
+                const auto warm_up_frames = std::min<size_t>(warm_up_frame_count, results.cpu_frame_times.size());
+                const auto measured_time = std::accumulate(results.cpu_frame_times.begin() + warm_up_frames, results.cpu_frame_times.end(), 0.0);
+                const auto measured_frames = results.cpu_frame_times.size() - warm_up_frames;
+
+                scene_results.push_back(fmt::format(
+                    R"(    {{"name": "{}", "render_path": "{}", "cubes": {}, "frames": {}, "fps": {:.2f}, "cpu_frame_ms": {}, "gpu_frame_ms": {}, "transform_update_ms": {}, "cpu_culling_ms": {}}})",
+                    scene.name,
+                    get_render_path_name(results.dynamic_rendering),
+                    scene.cube_count,
+                    measured_frames,
+                    measured_time > 0.0 ? static_cast<double>(measured_frames) / (measured_time / 1000.0) : 0.0,
+                    to_json(summarize(results.cpu_frame_times)),
+                    to_json(summarize(results.gpu_frame_times)),
+                    to_json(summarize(results.transform_update_times)),
+                    to_json(summarize(results.cpu_culling_times))
+                ));
+
+                // Ctrl-C stops the whole bench, not just the scene that happened to be running.
+                // What it got through so far still gets written out.
+                if (results.interrupted) {
+                    fmt::print(stderr, "[INFO]: Interrupted, skipping the remaining scenes.\n");
+                    interrupted = true;
+                    break;
+                }
+            }
+
+            if (interrupted) {
+                break;
+            }
+        }
+
+        const auto extent = base_options.headless_extent.value();
+
+        std::string json = fmt::format(
+            "{{\n  \"device\": \"{}\",\n  \"resolution\": [{}, {}],\n  \"frames_in_flight\": {},\n  \"gpu_culling\": {},\n"
+            "  \"recording_threads\": {},\n  \"worker_threads\": {},\n  \"animation\": \"{}\",\n  \"cpu_culling\": {},\n  \"scenes\": [\n",
+            escape_json(device_name), extent.width, extent.height, base_options.frames_in_flight,
+            base_options.gpu_culling, base_options.recording_threads,
+            base_options.worker_threads.value_or(pooper_cube::job_system_t::get_default_worker_count()),
+            pooper_cube::get_animation_name(base_options.animation),
+            base_options.cpu_culling && !base_options.gpu_culling
+        );
+
+        for (size_t i = 0; i < scene_results.size(); i++) {
+            json += scene_results[i];
+            json += i + 1 < scene_results.size() ? ",\n" : "\n";
+        }
+
+        json += "  ]\n}\n";
+
+        if (output_path.has_value()) {
+            std::ofstream output{output_path.value()};
+            output << json;
+
+            if (!output) {
+                throw pooper_cube::file_opening_exception_t{"benchmark output file"};
+            }
+        } else {
+            fmt::print("{}", json);
+        }
+    });
+}
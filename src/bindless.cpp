@@ -0,0 +1,203 @@
+#include "bindless.hpp"
+
+using pooper_cube::bindless_table_t;
+using pooper_cube::index_allocator_t;
+
+namespace {
+    // Plenty for a scene full of cubes, and well within what desktop drivers allow. Devices
+    // with lower limits get less.
+    constexpr std::array<uint32_t, 3> desired_capacities {
+        4096, // Storage buffers.
+        4096, // Sampled images.
+        256,  // Samplers.
+    };
+
+    constexpr std::array<VkDescriptorType, 3> descriptor_types {
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+        VK_DESCRIPTOR_TYPE_SAMPLER,
+    };
+
+    constexpr VkShaderStageFlags table_stages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+
+    auto get_bindings(const std::array<uint32_t, 3>& p_capacities) -> std::array<VkDescriptorSetLayoutBinding, 3> {
+        std::array<VkDescriptorSetLayoutBinding, 3> bindings;
+
+        for (uint32_t i = 0; i < bindings.size(); i++) {
+            bindings[i] = VkDescriptorSetLayoutBinding {
+                .binding = i,
+                .descriptorType = descriptor_types[i],
+                .descriptorCount = p_capacities[i],
+                .stageFlags = table_stages,
+                .pImmutableSamplers = nullptr,
+            };
+        }
+
+        return bindings;
+    }
+
+    auto get_pool_sizes(const std::array<uint32_t, 3>& p_capacities) -> std::array<VkDescriptorPoolSize, 3> {
+        std::array<VkDescriptorPoolSize, 3> sizes;
+
+        for (uint32_t i = 0; i < sizes.size(); i++) {
+            sizes[i] = VkDescriptorPoolSize {
+                .type = descriptor_types[i],
+                .descriptorCount = p_capacities[i],
+            };
+        }
+
+        return sizes;
+    }
+
+    // Slots that nothing has been written to yet are never read, so they're allowed to
+    // stay empty.
+    constexpr VkDescriptorBindingFlags table_binding_flags =
+        VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+        VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+
+    constexpr std::array<VkDescriptorBindingFlags, 3> binding_flags {
+        table_binding_flags, table_binding_flags, table_binding_flags
+    };
+}
+
+index_allocator_t::index_allocator_t(uint32_t p_capacity) :
+    m_capacity(p_capacity),
+    m_next(0),
+    m_free{}
+{}
+
+auto index_allocator_t::allocate() -> uint32_t {
+    if (!m_free.empty()) {
+        const auto index = m_free.back();
+        m_free.pop_back();
+        return index;
+    }
+
+    if (m_next == m_capacity) {
+        throw generic_vulkan_exception_t{VK_ERROR_OUT_OF_POOL_MEMORY, "The bindless table is full."};
+    }
+
+    return m_next++;
+}
+
+auto index_allocator_t::free(uint32_t p_index) -> void {
+    m_free.push_back(p_index);
+}
+
+auto bindless_table_t::get_capacities(const physical_device_t& p_physical_device) -> std::array<uint32_t, 3> {
+    VkPhysicalDeviceDescriptorIndexingProperties indexing_properties{};
+    indexing_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+    indexing_properties.pNext = nullptr;
+
+    VkPhysicalDeviceProperties2 properties {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &indexing_properties,
+        .properties = VkPhysicalDeviceProperties{},
+    };
+    vkGetPhysicalDeviceProperties2(p_physical_device, &properties);
+
+    // Every stage can see the whole table, so the per-stage limits apply as well as the
+    // per-set ones.
+    return std::array<uint32_t, 3> {
+        std::min({
+            desired_capacities[0],
+            indexing_properties.maxDescriptorSetUpdateAfterBindStorageBuffers,
+            indexing_properties.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+        }),
+        std::min({
+            desired_capacities[1],
+            indexing_properties.maxDescriptorSetUpdateAfterBindSampledImages,
+            indexing_properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+        }),
+        std::min({
+            desired_capacities[2],
+            indexing_properties.maxDescriptorSetUpdateAfterBindSamplers,
+            indexing_properties.maxPerStageDescriptorUpdateAfterBindSamplers,
+        }),
+    };
+}
+
+bindless_table_t::bindless_table_t(const physical_device_t& p_physical_device, const device_t& p_device, submission_tracker_t& p_submissions) :
+    m_device(p_device),
+    m_submissions(p_submissions),
+    m_capacities(get_capacities(p_physical_device)),
+    m_layout(p_device, get_bindings(m_capacities), VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT, binding_flags),
+    m_pool(p_device, get_pool_sizes(m_capacities), 1, VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT),
+    m_set(m_pool.allocate_set(m_layout)),
+    m_indices{index_allocator_t{m_capacities[0]}, index_allocator_t{m_capacities[1]}, index_allocator_t{m_capacities[2]}},
+    m_pending_removals{}
+{}
+
+auto bindless_table_t::add_storage_buffer(VkBuffer p_buffer, VkDeviceSize p_offset, VkDeviceSize p_range) -> uint32_t {
+    const auto index = get_indices(kind_t::storage_buffer).allocate();
+
+    const VkDescriptorBufferInfo buffer_info {
+        .buffer = p_buffer,
+        .offset = p_offset,
+        .range = p_range,
+    };
+
+    write(kind_t::storage_buffer, index, &buffer_info, nullptr);
+    return index;
+}
+
+auto bindless_table_t::add_sampled_image(VkImageView p_view, VkImageLayout p_layout) -> uint32_t {
+    const auto index = get_indices(kind_t::sampled_image).allocate();
+
+    const VkDescriptorImageInfo image_info {
+        .sampler = VK_NULL_HANDLE,
+        .imageView = p_view,
+        .imageLayout = p_layout,
+    };
+
+    write(kind_t::sampled_image, index, nullptr, &image_info);
+    return index;
+}
+
+auto bindless_table_t::add_sampler(VkSampler p_sampler) -> uint32_t {
+    const auto index = get_indices(kind_t::sampler).allocate();
+
+    const VkDescriptorImageInfo image_info {
+        .sampler = p_sampler,
+        .imageView = VK_NULL_HANDLE,
+        .imageLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+    };
+
+    write(kind_t::sampler, index, nullptr, &image_info);
+    return index;
+}
+
+auto bindless_table_t::remove(kind_t p_kind, uint32_t p_index, submission_t p_last_use) -> void {
+    m_pending_removals.push_back(pending_removal_t{p_kind, p_index, p_last_use});
+}
+
+auto bindless_table_t::collect() -> void {
+    // The slot keeps pointing at the old resource until it's handed out again, which is
+    // fine, since nothing reads from it in the meantime.
+    std::erase_if(m_pending_removals, [&](const pending_removal_t& p_removal) {
+        if (!m_submissions.is_retired(p_removal.last_use)) {
+            return false;
+        }
+
+        get_indices(p_removal.kind).free(p_removal.index);
+        return true;
+    });
+}
+
+auto bindless_table_t::write(kind_t p_kind, uint32_t p_index, const VkDescriptorBufferInfo* p_buffer_info, const VkDescriptorImageInfo* p_image_info) const -> void {
+    const VkWriteDescriptorSet descriptor_write {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .pNext = nullptr,
+        .dstSet = m_set,
+        .dstBinding = static_cast<uint32_t>(p_kind),
+        .dstArrayElement = p_index,
+        .descriptorCount = 1,
+        .descriptorType = descriptor_types[static_cast<uint32_t>(p_kind)],
+        .pImageInfo = p_image_info,
+        .pBufferInfo = p_buffer_info,
+        .pTexelBufferView = nullptr,
+    };
+
+    vkUpdateDescriptorSets(m_device, 1, &descriptor_write, 0, nullptr);
+}
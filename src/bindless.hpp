@@ -0,0 +1,93 @@
+#pragma once
+
+#include "common.hpp"
+#include "descriptors.hpp"
+#include "devices.hpp"
+#include "submissions.hpp"
+
+namespace pooper_cube {
+    // Hands out the slots of a fixed-size array. Slots that are given back get handed out
+    // again before any that have never been used.
+    class index_allocator_t {
+        public:
+            explicit index_allocator_t(uint32_t capacity);
+
+            // Throws once every slot is taken.
+            auto allocate() -> uint32_t;
+            auto free(uint32_t index) -> void;
+
+            auto get_capacity() const noexcept -> uint32_t { return m_capacity; }
+
+        private:
+            uint32_t m_capacity;
+
+            // Everything from here on up has never been handed out.
+            uint32_t m_next;
+            std::vector<uint32_t> m_free;
+    };
+
+    // A single descriptor set with big arrays of storage buffers, sampled images and
+    // samplers, which every pipeline shares as set 1. Resources get added to it once, and
+    // shaders pick them out of it with the index that they got, which they are handed in
+    // push constants (or anywhere else they can read from). Binding the table once per
+    // frame is all it takes, no matter how many resources there are.
+    //
+    // The arrays are update-after-bind and partially bound, so resources can come and go
+    // while frames that use the table are in flight, as long as those frames don't use the
+    // slots that change.
+    class bindless_table_t {
+        public:
+            // Doubles as the binding of the array.
+            enum class kind_t : uint32_t {
+                storage_buffer, sampled_image, sampler
+            };
+
+            bindless_table_t(const physical_device_t& physical_device, const device_t& device, submission_tracker_t& submissions);
+            NO_COPY(bindless_table_t);
+
+            operator VkDescriptorSet() const noexcept { return m_set; }
+
+            auto get_layout() const noexcept -> const descriptor_layout_t& { return m_layout; }
+
+            // None of these are thread safe.
+            auto add_storage_buffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE) -> uint32_t;
+            auto add_sampled_image(VkImageView view, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) -> uint32_t;
+            auto add_sampler(VkSampler sampler) -> uint32_t;
+
+            // The slot is only handed out again once the submission has retired, since
+            // frames that are still in flight may be reading from it.
+            auto remove(kind_t kind, uint32_t index, submission_t last_use) -> void;
+
+            // Frees the slots whose last submission has retired. Should be called once per
+            // frame.
+            auto collect() -> void;
+
+            auto get_capacity(kind_t kind) const noexcept -> uint32_t { return get_indices(kind).get_capacity(); }
+
+        private:
+            struct pending_removal_t {
+                kind_t kind;
+                uint32_t index;
+                submission_t last_use;
+            };
+
+            static auto get_capacities(const physical_device_t& physical_device) -> std::array<uint32_t, 3>;
+
+            auto get_indices(kind_t kind) noexcept -> index_allocator_t& { return m_indices[static_cast<uint32_t>(kind)]; }
+            auto get_indices(kind_t kind) const noexcept -> const index_allocator_t& { return m_indices[static_cast<uint32_t>(kind)]; }
+
+            auto write(kind_t kind, uint32_t index, const VkDescriptorBufferInfo* buffer_info, const VkDescriptorImageInfo* image_info) const -> void;
+
+            const device_t& m_device;
+            submission_tracker_t& m_submissions;
+
+            std::array<uint32_t, 3> m_capacities;
+
+            descriptor_layout_t m_layout;
+            descriptor_pool_t m_pool;
+            VkDescriptorSet m_set;
+
+            std::array<index_allocator_t, 3> m_indices;
+            std::vector<pending_removal_t> m_pending_removals;
+    };
+}
@@ -2,27 +2,18 @@
 
 using pooper_cube::buffer_t;
 
-namespace pooper_cube {
-    auto find_memory_type(const physical_device_t& p_physical_device, uint32_t p_type_filter, VkMemoryPropertyFlags properties) -> std::optional<uint32_t> {
-        VkPhysicalDeviceMemoryProperties memory_properties;
-        vkGetPhysicalDeviceMemoryProperties(p_physical_device, &memory_properties);
-
-        for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++) {
-            const bool is_suitable = p_type_filter & (1 << i);
-            const bool has_properties = memory_properties.memoryTypes[i].propertyFlags & properties;
+buffer_t::buffer_t(allocator_t& p_allocator, type_t p_type, VkDeviceSize p_size)
+    : m_device(p_allocator.get_device()), m_allocator(p_allocator), m_allocation{}, m_size(p_size)
+{
+    const auto& physical_device = p_allocator.get_physical_device();
 
-            if (is_suitable && has_properties) {
-                return i;
-            }
-        }
+    // Buffers that get uploaded to are written by the transfer queue and read by the
+    // graphics queue. If those are different families, then it's a lot simpler to just
+    // share the buffer between them than to transfer the ownership back and forth.
+    const std::array<uint32_t, 2> sharing_families{physical_device.graphics_queue_family, physical_device.transfer_queue_family};
+    const bool is_upload_target = p_type == type_t::vertex || p_type == type_t::element || p_type == type_t::instance;
+    const bool is_shared = is_upload_target && sharing_families[0] != sharing_families[1];
 
-        return std::optional<uint32_t>{};
-    }
-}
-
-buffer_t::buffer_t(const physical_device_t& p_physical_device, const device_t& p_device, type_t p_type, VkDeviceSize p_size)
-    : m_device(p_device), m_size(p_size)
-{
     const VkBufferCreateInfo buffer_info {
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
         .pNext = nullptr,
@@ -38,89 +29,51 @@ buffer_t::buffer_t(const physical_device_t& p_physical_device, const device_t& p
                     return VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
                 case type_t::uniform:
                     return VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+                case type_t::instance:
+                    // Also read (and written) by the culling shader.
+                    return VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+                case type_t::streamed_instance:
+                    // Written by the CPU every frame, so there's nothing to upload.
+                    return VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+                case type_t::indirect:
+                    return VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
             }
         }(),
-        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-        .queueFamilyIndexCount = 0,
-        .pQueueFamilyIndices = nullptr,
+        .sharingMode = is_shared ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = is_shared ? static_cast<uint32_t>(sharing_families.size()) : 0,
+        .pQueueFamilyIndices = is_shared ? sharing_families.data() : nullptr,
     };
 
-    auto result = vkCreateBuffer(p_device, &buffer_info, nullptr, &m_buffer);
+    auto result = vkCreateBuffer(m_device, &buffer_info, nullptr, &m_buffer);
     if (result != VK_SUCCESS) {
         throw vulkan_creation_exception_t{result, "vertex buffer"};
     }
 
     VkMemoryRequirements memory_requirements;
-    vkGetBufferMemoryRequirements(p_device, m_buffer, &memory_requirements);
-
-    const auto memory_type_index = find_memory_type(
-            p_physical_device, 
-            memory_requirements.memoryTypeBits, 
-            p_type == type_t::staging || p_type == type_t::uniform
-                ? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT 
-                : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-    );
-
-    if (!memory_type_index.has_value()) {
-        // We use VK_SUCCESS when Vulkan didn't return any error codes.
-        throw allocation_exception_t{VK_SUCCESS, "Could not find an adequate memory type."};
+    vkGetBufferMemoryRequirements(m_device, m_buffer, &memory_requirements);
+
+    const bool host_visible = p_type == type_t::staging || p_type == type_t::uniform || p_type == type_t::streamed_instance;
+
+    try {
+        m_allocation = m_allocator.allocate(
+            memory_requirements,
+            host_visible
+                ? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+                : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            resource_kind_t::buffer,
+            // Staging buffers only live until their copy is done, so they can just be
+            // stacked on top of each other.
+            p_type == type_t::staging ? allocation_strategy_t::linear : allocation_strategy_t::free_list
+        );
+    } catch (...) {
+        vkDestroyBuffer(m_device, m_buffer, nullptr);
+        throw;
     }
 
-    const VkMemoryAllocateInfo allocate_info {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .pNext = nullptr,
-        .allocationSize = memory_requirements.size,
-        .memoryTypeIndex = memory_type_index.value(),
-    };
-
-    result = vkAllocateMemory(m_device, &allocate_info, nullptr, &m_memory);
+    result = vkBindBufferMemory(m_device, m_buffer, m_allocation.memory, m_allocation.offset);
     if (result != VK_SUCCESS) {
-        throw allocation_exception_t{result, "Failed to allocate memory."};
+        vkDestroyBuffer(m_device, m_buffer, nullptr);
+        m_allocator.free(m_allocation);
+        throw allocator_t::allocation_exception_t{result, "Failed to bind the memory of a buffer."};
     }
-
-    vkBindBufferMemory(m_device, m_buffer, m_memory, 0);
-}
-
-auto buffer_t::copy_from(const buffer_t& p_source, const command_pool_t& p_command_pool) const -> void {
-    auto command_buffer = p_command_pool.allocate_command_buffer();
-
-    VkCommandBufferBeginInfo begin_info {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .pNext = nullptr,
-        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-        .pInheritanceInfo = nullptr,
-    };
-    
-    auto result = vkBeginCommandBuffer(command_buffer, &begin_info);
-    if (result != VK_SUCCESS) {
-        throw generic_vulkan_exception_t{result, "Failed to begin recording command buffer for copying two buffers."};
-    }
-
-    auto copy_size = std::min(m_size, p_source.m_size);
-
-    const VkBufferCopy buffer_copy {
-        .srcOffset = 0,
-        .dstOffset = 0,
-        .size = copy_size,
-    };
-
-    vkCmdCopyBuffer(command_buffer, p_source, *this, 1, &buffer_copy);
-
-    result = vkEndCommandBuffer(command_buffer);
-    if (result != VK_SUCCESS) {
-        throw generic_vulkan_exception_t{result, "Failed to end recording command ubffer for copying tow buffers."};
-    }
-
-    const VkSubmitInfo submit_info {
-        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .commandBufferCount = 1,
-        .pCommandBuffers = &command_buffer,
-    };
-
-    result = vkQueueSubmit(m_device.get_graphics_queue(), 1, &submit_info, VK_NULL_HANDLE);
-    if (result != VK_SUCCESS) {
-        throw generic_vulkan_exception_t{result, "Failed to submit command buffer for copying two buffers."};
-    }
-
-    vkQueueWaitIdle(m_device.get_graphics_queue());
 }
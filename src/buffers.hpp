@@ -3,6 +3,7 @@
 #include "common.hpp"
 #include "devices.hpp"
 #include "commands.hpp"
+#include "memory.hpp"
 
 namespace pooper_cube {
     struct vertex_t {
@@ -18,69 +19,74 @@ namespace pooper_cube {
         },
     };
 
+    // Everything that differs between two cubes.
+    struct instance_data_t {
+        glm::mat4 model;
+        glm::vec4 color;
+    };
+
+    // The instances aren't vertex attributes. The vertex shader reads them out of the
+    // bindless table instead.
+    static constexpr std::array<VkVertexInputBindingDescription, 1> vertex_binding_descriptions {
+        VkVertexInputBindingDescription {
+            .binding = 0,
+            .stride = sizeof(vertex_t),
+            .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+        },
+    };
+
     class buffer_t {
         public:
             enum class type_t {
-                vertex, element, staging, uniform
-            };
-
-            struct allocation_exception_t {
-                VkResult error_code;
-                std::string_view what;
+                vertex, element, staging, uniform, instance, streamed_instance, indirect
             };
 
-            buffer_t(const physical_device_t& physical_device, const device_t& device, type_t type, VkDeviceSize size);
+            buffer_t(allocator_t& allocator, type_t type, VkDeviceSize size);
             NO_COPY(buffer_t);
 
             operator VkBuffer() const noexcept {
                 return m_buffer;
             }
 
-            auto copy_from(const buffer_t& source, const command_pool_t& command_pool) const -> void;
+            auto get_size() const noexcept -> VkDeviceSize { return m_size; }
 
             virtual ~buffer_t() noexcept {
-                vkFreeMemory(m_device, m_memory, nullptr);
                 vkDestroyBuffer(m_device, m_buffer, nullptr);
+                m_allocator.free(m_allocation);
             }
 
         protected:
             const device_t& m_device;
+            allocator_t& m_allocator;
 
             VkBuffer m_buffer;
-            VkDeviceMemory m_memory;
+            allocation_t m_allocation;
             VkDeviceSize m_size;
     };
 
     class host_coherent_buffer_t : public buffer_t {
         public:
-            host_coherent_buffer_t(const physical_device_t& physical_device, const device_t& device, type_t type, VkDeviceSize size)
-                : buffer_t(physical_device, device, type, size)
+            host_coherent_buffer_t(allocator_t& allocator, type_t type, VkDeviceSize size)
+                : buffer_t(allocator, type, size)
             {}
 
+            // The memory blocks that the allocator hands out for these buffers stay mapped
+            // for their entire lifetime, so this is just a pointer into the block now and
+            // there's nothing to unmap.
             class mapped_memory_t {
                 public:
-                    mapped_memory_t(void* data, const host_coherent_buffer_t& buffer) :
-                        m_data(data), m_buffer(buffer) {}
+                    mapped_memory_t(void* data) : m_data(data) {}
                     NO_COPY(mapped_memory_t);
 
                     using data_type_t = void*;
                     operator data_type_t() const noexcept { return m_data; }
 
-                    ~mapped_memory_t() noexcept {
-                        vkUnmapMemory(m_buffer.m_device, m_buffer.m_memory);
-                    }
-
                 private:
                     void* m_data;
-                    const host_coherent_buffer_t& m_buffer;
             };
 
             auto map_memory() const noexcept -> mapped_memory_t {
-                void* data;
-                vkMapMemory(m_device, m_memory, 0, m_size, 0, &data);
-                return mapped_memory_t{data, *this};
+                return mapped_memory_t{m_allocation.mapped_data};
             }
     };
-
-    auto find_memory_type(const physical_device_t& p_physical_device, uint32_t p_type_filter, VkMemoryPropertyFlags properties) -> std::optional<uint32_t>; 
 }
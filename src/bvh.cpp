@@ -0,0 +1,501 @@
+#if defined(__SSE__) || defined(_M_X64)
+#define HAS_SSE_KERNEL
+#include <xmmintrin.h>
+#endif
+
+#include <algorithm>
+
+#include "bvh.hpp"
+
+using pooper_cube::instance_bvh_t;
+
+namespace {
+    // The half diagonal of a unit cube.
+    constexpr float cube_radius = 0.8660254f;
+
+    // What the lanes without a child are filled with. Not infinity, since multiplying that
+    // by the zero in a plane's normal would give us a NaN, which no comparison culls.
+    constexpr float empty_min = 1e30f;
+    constexpr float empty_max = -1e30f;
+
+    constexpr uint32_t all_planes = (1u << 6) - 1;
+
+    // Spreads the lowest 10 bits out, with two zeroes in between each of them.
+    auto spread_bits(uint32_t p_value) noexcept -> uint32_t {
+        p_value = (p_value * 0x00010001u) & 0xff0000ffu;
+        p_value = (p_value * 0x00000101u) & 0x0f00f00fu;
+        p_value = (p_value * 0x00000011u) & 0xc30c30c3u;
+        p_value = (p_value * 0x00000005u) & 0x49249249u;
+        return p_value;
+    }
+
+    // Takes a point inside of the unit cube from 0 to 1.
+    auto get_morton_code(const glm::vec3& p_point) noexcept -> uint32_t {
+        const auto quantize = [](float p_coordinate) {
+            return static_cast<uint32_t>(std::clamp(p_coordinate * 1024.0f, 0.0f, 1023.0f));
+        };
+
+        return (spread_bits(quantize(p_point.x)) << 2) | (spread_bits(quantize(p_point.y)) << 1) | spread_bits(quantize(p_point.z));
+    }
+
+    // Sorts the codes, which have to fit into 30 bits, from least to most significant digit.
+    // Every pass counts the digits of each chunk of codes on the job system, works out where
+    // each chunk's share of every digit starts, and then has each chunk scatter its codes
+    // there. It's stable, so codes that are the same stay in the order that they came in.
+    auto radix_sort(std::vector<std::pair<uint32_t, uint32_t>>& p_codes, pooper_cube::job_system_t& p_jobs) -> void {
+        constexpr uint32_t digit_bits = 10;
+        constexpr uint32_t pass_count = 3;
+        constexpr size_t digit_count = size_t{1} << digit_bits;
+
+        // Small enough to leave every thread something to do, big enough for the counts to
+        // be worth handing out. The chunks don't depend on the threads that end up running
+        // them, so neither does the order.
+        constexpr size_t min_chunk_size = 16384;
+
+        const auto count = p_codes.size();
+        const auto chunk_count = std::clamp<size_t>(count / min_chunk_size, 1, p_jobs.get_worker_count() + 1);
+        const auto chunk_size = (count + chunk_count - 1) / chunk_count;
+
+        std::vector<std::pair<uint32_t, uint32_t>> sorted(count);
+        std::vector<uint32_t> offsets(chunk_count * digit_count);
+
+        for (uint32_t pass = 0; pass < pass_count; pass++) {
+            const auto shift = pass * digit_bits;
+            const auto get_digit = [shift](uint32_t p_code) { return (p_code >> shift) & (digit_count - 1); };
+
+            p_jobs.parallel_for(chunk_count, 1, [&](size_t p_begin, size_t p_end) {
+                for (auto chunk = p_begin; chunk < p_end; chunk++) {
+                    const auto chunk_offsets = offsets.begin() + static_cast<ptrdiff_t>(chunk * digit_count);
+                    std::fill(chunk_offsets, chunk_offsets + digit_count, 0u);
+
+                    for (auto i = chunk * chunk_size; i < std::min(count, (chunk + 1) * chunk_size); i++) {
+                        chunk_offsets[get_digit(p_codes[i].first)]++;
+                    }
+                }
+            });
+
+            // Every digit starts with the codes of the first chunk, then the second one, and
+            // so on.
+            uint32_t offset = 0;
+            for (size_t digit = 0; digit < digit_count; digit++) {
+                for (size_t chunk = 0; chunk < chunk_count; chunk++) {
+                    const auto digit_total = offsets[chunk * digit_count + digit];
+                    offsets[chunk * digit_count + digit] = offset;
+                    offset += digit_total;
+                }
+            }
+
+            p_jobs.parallel_for(chunk_count, 1, [&](size_t p_begin, size_t p_end) {
+                for (auto chunk = p_begin; chunk < p_end; chunk++) {
+                    const auto chunk_offsets = offsets.begin() + static_cast<ptrdiff_t>(chunk * digit_count);
+
+                    for (auto i = chunk * chunk_size; i < std::min(count, (chunk + 1) * chunk_size); i++) {
+                        sorted[chunk_offsets[get_digit(p_codes[i].first)]++] = p_codes[i];
+                    }
+                }
+            });
+
+            std::swap(p_codes, sorted);
+        }
+    }
+
+    // Pulling the planes out of the combined matrix gives them to us in the same space as
+    // the instances (Gribb & Hartmann), the same as cull.comp does. The depth range is 0 to
+    // 1, hence the near plane. They point into the frustum, and aren't normalized, since
+    // only the sign of the distance matters.
+    auto get_planes(const glm::mat4& p_transform) noexcept -> std::array<glm::vec4, 6> {
+        const auto row = [&](int p_row) {
+            return glm::vec4{p_transform[0][p_row], p_transform[1][p_row], p_transform[2][p_row], p_transform[3][p_row]};
+        };
+
+        return std::array<glm::vec4, 6> {
+            row(3) + row(0),
+            row(3) - row(0),
+            row(3) + row(1),
+            row(3) - row(1),
+            row(2),
+            row(3) - row(2),
+        };
+    }
+}
+
+instance_bvh_t::instance_bvh_t(std::span<const instance_data_t> p_instances, bool p_loose_bounds, job_system_t& p_jobs) :
+    m_count(static_cast<uint32_t>(p_instances.size())),
+    m_loose_bounds(p_loose_bounds),
+    m_order(m_count),
+    m_slots(m_count),
+    m_centers(m_count),
+    m_extents(m_count),
+    m_levels{},
+    m_dirty{},
+    m_any_dirty(true),
+    m_tasks{},
+    m_task_results{}
+{
+    if (m_count == 0) {
+        return;
+    }
+
+    // The Morton codes need the centers squeezed into a cube from 0 to 1.
+    glm::vec3 lowest{p_instances[0].model[3][0], p_instances[0].model[3][1], p_instances[0].model[3][2]};
+    glm::vec3 highest = lowest;
+
+    for (const auto& instance : p_instances) {
+        for (int axis = 0; axis < 3; axis++) {
+            lowest[axis] = std::min(lowest[axis], instance.model[3][axis]);
+            highest[axis] = std::max(highest[axis], instance.model[3][axis]);
+        }
+    }
+
+    const glm::vec3 size = highest - lowest;
+    const glm::vec3 scale{
+        size.x > 0.0f ? 1.0f / size.x : 0.0f,
+        size.y > 0.0f ? 1.0f / size.y : 0.0f,
+        size.z > 0.0f ? 1.0f / size.z : 0.0f,
+    };
+
+    // Ties are broken by the index, so that the tree comes out the same on every run. The
+    // codes start out in the order of the indices, and the sort keeps them that way.
+    std::vector<std::pair<uint32_t, uint32_t>> codes(m_count);
+
+    p_jobs.parallel_for(m_count, [&](size_t p_begin, size_t p_end) {
+        for (auto i = p_begin; i < p_end; i++) {
+            const auto& model = p_instances[i].model;
+            const glm::vec3 center{model[3][0], model[3][1], model[3][2]};
+
+            codes[i] = std::pair{get_morton_code((center - lowest) * scale), static_cast<uint32_t>(i)};
+        }
+    });
+
+    radix_sort(codes, p_jobs);
+
+    p_jobs.parallel_for(m_count, [&](size_t p_begin, size_t p_end) {
+        for (auto slot = p_begin; slot < p_end; slot++) {
+            const auto index = codes[slot].second;
+
+            m_order[slot] = index;
+            m_slots[index] = static_cast<uint32_t>(slot);
+
+            const auto [center, extent] = get_bounds(p_instances[index].model);
+            m_centers[slot] = center;
+            m_extents[slot] = extent;
+        }
+    });
+
+    // Every level has a quarter of the nodes of the one below it, until there's only the
+    // root left.
+    size_t node_count = m_count;
+    do {
+        node_count = (node_count + width - 1) / width;
+
+        m_levels.emplace_back(node_count);
+        m_dirty.emplace_back(node_count, 1);
+    } while (node_count > 1);
+
+    refit(p_jobs);
+}
+
+auto instance_bvh_t::get_bounds(const glm::mat4& p_model) const noexcept -> std::pair<glm::vec3, glm::vec3> {
+    const glm::vec3 center{p_model[3][0], p_model[3][1], p_model[3][2]};
+
+    if (m_loose_bounds) {
+        const auto largest_scale = std::max({
+            glm::length(glm::vec3{p_model[0][0], p_model[0][1], p_model[0][2]}),
+            glm::length(glm::vec3{p_model[1][0], p_model[1][1], p_model[1][2]}),
+            glm::length(glm::vec3{p_model[2][0], p_model[2][1], p_model[2][2]}),
+        });
+
+        const auto radius = cube_radius * largest_scale;
+        return std::pair{center, glm::vec3{radius, radius, radius}};
+    }
+
+    // How far the corners of the cube reach along each axis, after it's been turned and
+    // scaled.
+    glm::vec3 extent;
+    for (int axis = 0; axis < 3; axis++) {
+        extent[axis] = 0.5f * (std::abs(p_model[0][axis]) + std::abs(p_model[1][axis]) + std::abs(p_model[2][axis]));
+    }
+
+    return std::pair{center, extent};
+}
+
+auto instance_bvh_t::get_child_count(uint32_t p_level) const noexcept -> uint32_t {
+    return p_level == 0 ? m_count : static_cast<uint32_t>(m_levels[p_level - 1].size());
+}
+
+auto instance_bvh_t::set_instance(uint32_t p_index, const glm::mat4& p_model) -> void {
+    const auto slot = m_slots[p_index];
+
+    const auto [center, extent] = get_bounds(p_model);
+    m_centers[slot] = center;
+    m_extents[slot] = extent;
+
+    m_dirty[0][slot / width] = 1;
+    m_any_dirty = true;
+}
+
+auto instance_bvh_t::refit(job_system_t& p_jobs) -> void {
+    if (!m_any_dirty) {
+        return;
+    }
+
+    // Every level needs the one below it to be done, but the nodes of a level don't need
+    // each other.
+    for (uint32_t level = 0; level < m_levels.size(); level++) {
+        auto& nodes = m_levels[level];
+        auto& dirty = m_dirty[level];
+        const auto child_count = get_child_count(level);
+
+        p_jobs.parallel_for(nodes.size(), 1024, [&](size_t p_begin, size_t p_end) {
+            for (auto i = p_begin; i < p_end; i++) {
+                const auto first_child = static_cast<uint32_t>(i * width);
+
+                // The leaves were marked by set_instance(), everything above them is dirty
+                // if any of its children are.
+                if (level > 0) {
+                    const auto& child_dirty = m_dirty[level - 1];
+                    const auto end_child = std::min(first_child + width, child_count);
+                    dirty[i] = std::any_of(child_dirty.begin() + first_child, child_dirty.begin() + end_child, [](uint8_t p_flag) { return p_flag != 0; });
+                }
+
+                if (dirty[i] == 0) {
+                    continue;
+                }
+
+                auto& node = nodes[i];
+                for (uint32_t lane = 0; lane < width; lane++) {
+                    const auto child = first_child + lane;
+
+                    node.min_x[lane] = node.min_y[lane] = node.min_z[lane] = empty_min;
+                    node.max_x[lane] = node.max_y[lane] = node.max_z[lane] = empty_max;
+
+                    if (child >= child_count) {
+                        continue;
+                    }
+
+                    if (level == 0) {
+                        const auto& center = m_centers[child];
+                        const auto& extent = m_extents[child];
+
+                        node.min_x[lane] = center.x - extent.x;
+                        node.min_y[lane] = center.y - extent.y;
+                        node.min_z[lane] = center.z - extent.z;
+                        node.max_x[lane] = center.x + extent.x;
+                        node.max_y[lane] = center.y + extent.y;
+                        node.max_z[lane] = center.z + extent.z;
+                        continue;
+                    }
+
+                    // The box around all of the child's boxes. Its empty lanes are inside
+                    // out, so they never win.
+                    const auto& child_node = m_levels[level - 1][child];
+                    node.min_x[lane] = *std::min_element(child_node.min_x.begin(), child_node.min_x.end());
+                    node.min_y[lane] = *std::min_element(child_node.min_y.begin(), child_node.min_y.end());
+                    node.min_z[lane] = *std::min_element(child_node.min_z.begin(), child_node.min_z.end());
+                    node.max_x[lane] = *std::max_element(child_node.max_x.begin(), child_node.max_x.end());
+                    node.max_y[lane] = *std::max_element(child_node.max_y.begin(), child_node.max_y.end());
+                    node.max_z[lane] = *std::max_element(child_node.max_z.begin(), child_node.max_z.end());
+                }
+            }
+        });
+    }
+
+    for (auto& dirty : m_dirty) {
+        std::fill(dirty.begin(), dirty.end(), 0);
+    }
+
+    m_any_dirty = false;
+}
+
+auto instance_bvh_t::test_node(const node_t& p_node, const std::array<glm::vec4, 6>& p_planes, uint32_t p_plane_mask, std::array<uint32_t, width>& p_child_masks) const noexcept -> uint32_t {
+    uint32_t outside = 0;
+    p_child_masks.fill(0);
+
+    // A box is outside of a plane if even its corner that is the furthest along the normal
+    // is behind it, and it's completely inside if even the corner that is the furthest
+    // against the normal is in front of it. Only the planes that the box crosses have to be
+    // tested again further down.
+#ifdef HAS_SSE_KERNEL
+    const auto min_x = _mm_load_ps(p_node.min_x.data());
+    const auto min_y = _mm_load_ps(p_node.min_y.data());
+    const auto min_z = _mm_load_ps(p_node.min_z.data());
+    const auto max_x = _mm_load_ps(p_node.max_x.data());
+    const auto max_y = _mm_load_ps(p_node.max_y.data());
+    const auto max_z = _mm_load_ps(p_node.max_z.data());
+    const auto zero = _mm_setzero_ps();
+
+    for (uint32_t i = 0; i < p_planes.size(); i++) {
+        if ((p_plane_mask & (1u << i)) == 0) {
+            continue;
+        }
+
+        const auto& plane = p_planes[i];
+        const auto normal_x = _mm_set1_ps(plane.x);
+        const auto normal_y = _mm_set1_ps(plane.y);
+        const auto normal_z = _mm_set1_ps(plane.z);
+        const auto offset = _mm_set1_ps(plane.w);
+
+        const auto furthest = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(normal_x, plane.x >= 0.0f ? max_x : min_x), _mm_mul_ps(normal_y, plane.y >= 0.0f ? max_y : min_y)),
+            _mm_add_ps(_mm_mul_ps(normal_z, plane.z >= 0.0f ? max_z : min_z), offset)
+        );
+
+        const auto nearest = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(normal_x, plane.x >= 0.0f ? min_x : max_x), _mm_mul_ps(normal_y, plane.y >= 0.0f ? min_y : max_y)),
+            _mm_add_ps(_mm_mul_ps(normal_z, plane.z >= 0.0f ? min_z : max_z), offset)
+        );
+
+        outside |= static_cast<uint32_t>(_mm_movemask_ps(_mm_cmplt_ps(furthest, zero)));
+        const auto crossing = static_cast<uint32_t>(_mm_movemask_ps(_mm_cmplt_ps(nearest, zero)));
+
+        for (uint32_t lane = 0; lane < width; lane++) {
+            if ((crossing & (1u << lane)) != 0) {
+                p_child_masks[lane] |= 1u << i;
+            }
+        }
+    }
+#else
+    for (uint32_t i = 0; i < p_planes.size(); i++) {
+        if ((p_plane_mask & (1u << i)) == 0) {
+            continue;
+        }
+
+        const auto& plane = p_planes[i];
+
+        for (uint32_t lane = 0; lane < width; lane++) {
+            const auto furthest =
+                plane.x * (plane.x >= 0.0f ? p_node.max_x[lane] : p_node.min_x[lane]) +
+                plane.y * (plane.y >= 0.0f ? p_node.max_y[lane] : p_node.min_y[lane]) +
+                plane.z * (plane.z >= 0.0f ? p_node.max_z[lane] : p_node.min_z[lane]) + plane.w;
+
+            const auto nearest =
+                plane.x * (plane.x >= 0.0f ? p_node.min_x[lane] : p_node.max_x[lane]) +
+                plane.y * (plane.y >= 0.0f ? p_node.min_y[lane] : p_node.max_y[lane]) +
+                plane.z * (plane.z >= 0.0f ? p_node.min_z[lane] : p_node.max_z[lane]) + plane.w;
+
+            if (furthest < 0.0f) {
+                outside |= 1u << lane;
+            }
+
+            if (nearest < 0.0f) {
+                p_child_masks[lane] |= 1u << i;
+            }
+        }
+    }
+#endif
+
+    return ~outside & ((1u << width) - 1);
+}
+
+auto instance_bvh_t::gather_tasks(const task_t& p_task, const std::array<glm::vec4, 6>& p_planes, uint32_t p_split_level) -> void {
+    if (p_task.level <= p_split_level) {
+        m_tasks.push_back(p_task);
+        return;
+    }
+
+    // Subtrees that are completely inside still get split up, so that emitting all of
+    // their instances is spread out too.
+    std::array<uint32_t, width> child_masks{};
+    const auto surviving = p_task.plane_mask == 0
+        ? (1u << width) - 1
+        : test_node(m_levels[p_task.level][p_task.node], p_planes, p_task.plane_mask, child_masks);
+
+    const auto child_count = get_child_count(p_task.level);
+
+    for (uint32_t lane = 0; lane < width; lane++) {
+        const auto child = p_task.node * width + lane;
+
+        if ((surviving & (1u << lane)) != 0 && child < child_count) {
+            gather_tasks(task_t{p_task.level - 1, child, child_masks[lane]}, p_planes, p_split_level);
+        }
+    }
+}
+
+auto instance_bvh_t::cull_task(const task_t& p_task, const std::array<glm::vec4, 6>& p_planes, std::vector<uint32_t>& p_visible) const -> void {
+    // Everything under a node that is completely inside is visible, and its slots are all
+    // next to each other.
+    if (p_task.plane_mask == 0) {
+        static_assert(width == 4);
+        const size_t span = size_t{1} << (2 * (p_task.level + 1));
+
+        const auto begin = std::min<size_t>(p_task.node * span, m_count);
+        const auto end = std::min<size_t>(begin + span, m_count);
+        p_visible.insert(p_visible.end(), m_order.begin() + begin, m_order.begin() + end);
+        return;
+    }
+
+    std::array<uint32_t, width> child_masks;
+    const auto surviving = test_node(m_levels[p_task.level][p_task.node], p_planes, p_task.plane_mask, child_masks);
+    const auto child_count = get_child_count(p_task.level);
+
+    for (uint32_t lane = 0; lane < width; lane++) {
+        const auto child = p_task.node * width + lane;
+
+        if ((surviving & (1u << lane)) == 0 || child >= child_count) {
+            continue;
+        }
+
+        if (p_task.level == 0) {
+            p_visible.push_back(m_order[child]);
+        } else {
+            cull_task(task_t{p_task.level - 1, child, child_masks[lane]}, p_planes, p_visible);
+        }
+    }
+}
+
+auto instance_bvh_t::cull(const glm::mat4& p_transform, job_system_t& p_jobs, std::vector<uint32_t>& p_visible) -> void {
+    p_visible.clear();
+
+    if (m_count == 0) {
+        return;
+    }
+
+    const auto planes = get_planes(p_transform);
+    const auto root_level = static_cast<uint32_t>(m_levels.size() - 1);
+
+    // The highest level with enough nodes for every thread to get a few of them, so that
+    // the ones that end up with more of the view don't hold everybody else up.
+    const size_t desired_task_count = (p_jobs.get_worker_count() + 1) * 8;
+
+    uint32_t split_level = root_level;
+    while (split_level > 0 && m_levels[split_level].size() < desired_task_count) {
+        split_level--;
+    }
+
+    m_tasks.clear();
+    gather_tasks(task_t{root_level, 0, all_planes}, planes, split_level);
+
+    if (m_task_results.size() < m_tasks.size()) {
+        m_task_results.resize(m_tasks.size());
+    }
+
+    p_jobs.parallel_for(m_tasks.size(), 1, [&](size_t p_begin, size_t p_end) {
+        for (auto i = p_begin; i < p_end; i++) {
+            m_task_results[i].clear();
+            cull_task(m_tasks[i], planes, m_task_results[i]);
+        }
+    });
+
+    // The tasks are in the order of the tree, so the results just get put one after the
+    // other.
+    std::vector<size_t> offsets(m_tasks.size() + 1, 0);
+    for (size_t i = 0; i < m_tasks.size(); i++) {
+        offsets[i + 1] = offsets[i] + m_task_results[i].size();
+    }
+
+    p_visible.resize(offsets.back());
+
+    p_jobs.parallel_for(m_tasks.size(), 16, [&](size_t p_begin, size_t p_end) {
+        for (auto i = p_begin; i < p_end; i++) {
+            std::copy(m_task_results[i].begin(), m_task_results[i].end(), p_visible.begin() + static_cast<std::ptrdiff_t>(offsets[i]));
+        }
+    });
+}
+
+auto instance_bvh_t::get_kernel_name() noexcept -> std::string_view {
+#ifdef HAS_SSE_KERNEL
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "common.hpp"
+#include "buffers.hpp"
+#include "jobs.hpp"
+
+namespace pooper_cube {
+    // A bounding volume hierarchy over the instances, for throwing away the ones outside of
+    // the view on the CPU. The instances are assumed to be unit cubes, like the one that
+    // generate_cube(1.0f) makes. Every node holds the boxes of its four children side by
+    // side, so that a single frustum test covers all four of them at once with SSE.
+    //
+    // The tree isn't built from the top down. The instances get sorted along a Morton curve
+    // through their centers instead, so that neighbours in the order are mostly neighbours
+    // in space too, and every four consecutive nodes of a level become the children of one
+    // node of the level above. The shape of the tree then only depends on the number of
+    // instances, so refitting it after some of them moved just recomputes the boxes above
+    // them, one level at a time.
+    class instance_bvh_t {
+        public:
+            // Loose bounds are the boxes around the bounding spheres of the cubes, which stay
+            // the same no matter how the cubes are turned around their centers. Cubes that
+            // only spin never need a refit then.
+            instance_bvh_t(std::span<const instance_data_t> instances, bool loose_bounds, job_system_t& jobs);
+            NO_COPY(instance_bvh_t);
+
+            // Only shows up in the tree after the next refit().
+            auto set_instance(uint32_t index, const glm::mat4& model) -> void;
+
+            // Recomputes the boxes of every node that has a moved instance under it. The
+            // nodes of each level are spread over the job system.
+            auto refit(job_system_t& jobs) -> void;
+
+            // Replaces the contents of p_visible with the indices of every instance whose box
+            // is at least partly inside of the frustum of the given transform (usually the
+            // projection, view and model matrix), in the order of the tree.
+            auto cull(const glm::mat4& transform, job_system_t& jobs, std::vector<uint32_t>& visible) -> void;
+
+            auto get_count() const noexcept -> uint32_t { return m_count; }
+
+            // Which of the kernels cull() ends up using.
+            static auto get_kernel_name() noexcept -> std::string_view;
+
+        private:
+            static constexpr uint32_t width = 4;
+
+            // Structure of arrays, so that the boxes load straight into SIMD registers. Lanes
+            // that have no child are inside out, which every plane throws away.
+            struct node_t {
+                alignas(16) std::array<float, width> min_x;
+                alignas(16) std::array<float, width> min_y;
+                alignas(16) std::array<float, width> min_z;
+                alignas(16) std::array<float, width> max_x;
+                alignas(16) std::array<float, width> max_y;
+                alignas(16) std::array<float, width> max_z;
+            };
+
+            // A node of some level whose subtree still has to be culled, with the planes that
+            // its box isn't completely inside of yet.
+            struct task_t {
+                uint32_t level;
+                uint32_t node;
+                uint32_t plane_mask;
+            };
+
+            auto get_bounds(const glm::mat4& model) const noexcept -> std::pair<glm::vec3, glm::vec3>;
+
+            // The number of children (nodes, or instances for the leaves) below a level.
+            auto get_child_count(uint32_t level) const noexcept -> uint32_t;
+
+            // Tests the node's children against the planes of the mask. Returns a bit for
+            // every child that survived, and fills in the planes that each of them still
+            // crosses.
+            auto test_node(const node_t& node, const std::array<glm::vec4, 6>& planes, uint32_t plane_mask, std::array<uint32_t, width>& child_masks) const noexcept -> uint32_t;
+
+            auto cull_task(const task_t& task, const std::array<glm::vec4, 6>& planes, std::vector<uint32_t>& visible) const -> void;
+
+            // Splits the top of the tree up into tasks, culling it along the way.
+            auto gather_tasks(const task_t& task, const std::array<glm::vec4, 6>& planes, uint32_t split_level) -> void;
+
+            uint32_t m_count;
+            bool m_loose_bounds;
+
+            // The instance in each slot of the leaves, and the other way around.
+            std::vector<uint32_t> m_order;
+            std::vector<uint32_t> m_slots;
+
+            // Per slot.
+            std::vector<glm::vec3> m_centers;
+            std::vector<glm::vec3> m_extents;
+
+            // From the leaves up to the root, which is the only node of the last level.
+            std::vector<std::vector<node_t>> m_levels;
+
+            // Per node of every level. Set for the leaves by set_instance(), and passed up to
+            // the root by refit().
+            std::vector<std::vector<uint8_t>> m_dirty;
+            bool m_any_dirty;
+
+            // Reused by every cull(), so that they don't have to be allocated again.
+            std::vector<task_t> m_tasks;
+            std::vector<std::vector<uint32_t>> m_task_results;
+    };
+}
@@ -16,12 +16,12 @@ command_pool_t::command_pool_t(const device_t& p_device, uint32_t p_queue_family
     }
 }
 
-auto command_pool_t::allocate_command_buffer() const -> VkCommandBuffer {
+auto command_pool_t::allocate_command_buffer(VkCommandBufferLevel p_level) const -> VkCommandBuffer {
     const VkCommandBufferAllocateInfo alloc_info {
         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
         .pNext = nullptr,
         .commandPool = m_pool,
-        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .level = p_level,
         .commandBufferCount = 1,
     };
 
@@ -33,3 +33,10 @@ auto command_pool_t::allocate_command_buffer() const -> VkCommandBuffer {
 
     return buffer;
 }
+
+auto command_pool_t::reset() const -> void {
+    const auto result = vkResetCommandPool(m_device, m_pool, 0);
+    if (result != VK_SUCCESS) {
+        throw generic_vulkan_exception_t{result, "Failed to reset a command pool."};
+    }
+}
@@ -11,7 +11,10 @@ namespace pooper_cube {
 
             operator VkCommandPool() const noexcept { return m_pool; }
 
-            auto allocate_command_buffer() const -> VkCommandBuffer;
+            auto allocate_command_buffer(VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY) const -> VkCommandBuffer;
+
+            // Resets every command buffer that came from this pool at once.
+            auto reset() const -> void;
 
             ~command_pool_t() noexcept {
                 vkDestroyCommandPool(m_device, m_pool, nullptr);
@@ -0,0 +1,43 @@
+#include "deletion-queue.hpp"
+
+using pooper_cube::deletion_queue_t;
+
+deletion_queue_t::deletion_queue_t(submission_tracker_t& p_submissions, uint32_t p_frame_delay) :
+    m_submissions(p_submissions),
+    m_frame_delay(p_frame_delay),
+    m_frame_number(0)
+{}
+
+auto deletion_queue_t::collect() -> void {
+    m_frame_number++;
+
+    // Objects that were deferred later may well be done before earlier ones (they could
+    // have been used on another queue, for example), but keeping them in order means that
+    // something can't get destroyed before whatever was deferred ahead of it.
+    while (!m_entries.empty()) {
+        const auto& entry = m_entries.front();
+
+        if (m_frame_number - entry.frame_number < m_frame_delay || !m_submissions.is_retired(entry.last_use)) {
+            break;
+        }
+
+        m_entries.pop_front();
+    }
+}
+
+auto deletion_queue_t::flush() -> void {
+    while (!m_entries.empty()) {
+        m_submissions.wait(m_entries.front().last_use);
+        m_entries.pop_front();
+    }
+}
+
+deletion_queue_t::~deletion_queue_t() noexcept {
+    try {
+        flush();
+    } catch (...) {
+        // Most likely, the device got lost, in which case there's nothing left to wait
+        // for anyway.
+        m_entries.clear();
+    }
+}
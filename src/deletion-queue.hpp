@@ -0,0 +1,56 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+
+#include "common.hpp"
+#include "submissions.hpp"
+
+namespace pooper_cube {
+    // Holds on to objects that nothing new is going to use anymore, but that the GPU may
+    // still be busy with, and destroys them once it's safe to do so. Saves having to wait
+    // for the whole device to go idle just to get rid of something.
+    class deletion_queue_t {
+        public:
+            // Objects are only destroyed once their last submission has retired, and at
+            // least this many calls to collect() have gone by since they were deferred.
+            // Presenting isn't tracked by the submissions, so the frame delay is what gives
+            // the presentation engine time to let go of a swap chain.
+            deletion_queue_t(submission_tracker_t& submissions, uint32_t frame_delay);
+            NO_COPY(deletion_queue_t);
+
+            template<typename T>
+            auto defer(std::unique_ptr<T> object, submission_t last_use) -> void {
+                m_entries.push_back(entry_t{
+                    .last_use = last_use,
+                    .frame_number = m_frame_number,
+                    .object = object_t{object.release(), [](void* p_object) { delete static_cast<T*>(p_object); }},
+                });
+            }
+
+            // Should be called once per frame.
+            auto collect() -> void;
+
+            // Waits for everything to retire and destroys all of it.
+            auto flush() -> void;
+
+            ~deletion_queue_t() noexcept;
+
+        private:
+            using object_t = std::unique_ptr<void, void (*)(void*)>;
+
+            struct entry_t {
+                submission_t last_use;
+                uint64_t frame_number;
+                object_t object;
+            };
+
+            submission_tracker_t& m_submissions;
+            uint32_t m_frame_delay;
+            uint64_t m_frame_number;
+
+            // In the order that the objects were deferred in, which is also the order that
+            // they get destroyed in.
+            std::deque<entry_t> m_entries;
+    };
+}
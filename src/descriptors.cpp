@@ -1,13 +1,26 @@
 #include "descriptors.hpp"
 
 namespace pooper_cube {
-    descriptor_layout_t::descriptor_layout_t(const device_t& p_device, std::span<const VkDescriptorSetLayoutBinding> p_bindings) :
-        m_device(p_device)
+    descriptor_layout_t::descriptor_layout_t(
+        const device_t& p_device,
+        std::span<const VkDescriptorSetLayoutBinding> p_bindings,
+        VkDescriptorSetLayoutCreateFlags p_flags,
+        std::span<const VkDescriptorBindingFlags> p_binding_flags
+    ) :
+        m_device(p_device),
+        m_bindings(p_bindings.begin(), p_bindings.end())
     {
+        const VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+            .pNext = nullptr,
+            .bindingCount = static_cast<uint32_t>(p_binding_flags.size()),
+            .pBindingFlags = p_binding_flags.data(),
+        };
+
         const VkDescriptorSetLayoutCreateInfo layout_info {
             .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-            .pNext = nullptr,
-            .flags = 0,
+            .pNext = p_binding_flags.empty() ? nullptr : &binding_flags_info,
+            .flags = p_flags,
             .bindingCount = static_cast<uint32_t>(p_bindings.size()),
             .pBindings = p_bindings.data(),
         };
@@ -18,13 +31,106 @@ namespace pooper_cube {
         }
     }
 
-    descriptor_pool_t::descriptor_pool_t(const device_t& p_device, std::span<const VkDescriptorPoolSize> p_sizes, uint32_t p_max_sets) :
+    descriptor_update_template_t::descriptor_update_template_t(const device_t& p_device, const descriptor_layout_t& p_layout) :
+        descriptor_update_template_t(p_device, p_layout, VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET, VK_PIPELINE_BIND_POINT_GRAPHICS, VK_NULL_HANDLE, 0)
+    {}
+
+    descriptor_update_template_t::descriptor_update_template_t(
+        const device_t& p_device,
+        const descriptor_layout_t& p_layout,
+        VkPipelineBindPoint p_bind_point,
+        VkPipelineLayout p_pipeline_layout,
+        uint32_t p_set
+    ) :
+        descriptor_update_template_t(p_device, p_layout, VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR, p_bind_point, p_pipeline_layout, p_set)
+    {}
+
+    descriptor_update_template_t::descriptor_update_template_t(
+        const device_t& p_device,
+        const descriptor_layout_t& p_layout,
+        VkDescriptorUpdateTemplateType p_type,
+        VkPipelineBindPoint p_bind_point,
+        VkPipelineLayout p_pipeline_layout,
+        uint32_t p_set
+    ) :
+        m_device(p_device),
+        m_data_size(0),
+        m_pipeline_layout(p_pipeline_layout),
+        m_set(p_set)
+    {
+        std::vector<VkDescriptorUpdateTemplateEntry> entries;
+        entries.reserve(p_layout.get_bindings().size());
+
+        // All three of the info types are a multiple of 8 bytes in size, so packing them
+        // tightly gives the same offsets that a struct would have.
+        for (const auto& binding : p_layout.get_bindings()) {
+            size_t stride;
+
+            switch (binding.descriptorType) {
+                case VK_DESCRIPTOR_TYPE_SAMPLER:
+                case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+                case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+                case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+                case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+                    stride = sizeof(VkDescriptorImageInfo);
+                    break;
+                case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+                case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+                    stride = sizeof(VkBufferView);
+                    break;
+                default:
+                    stride = sizeof(VkDescriptorBufferInfo);
+                    break;
+            }
+
+            entries.push_back(
+                VkDescriptorUpdateTemplateEntry {
+                    .dstBinding = binding.binding,
+                    .dstArrayElement = 0,
+                    .descriptorCount = binding.descriptorCount,
+                    .descriptorType = binding.descriptorType,
+                    .offset = m_data_size,
+                    .stride = stride,
+                }
+            );
+
+            m_data_size += stride * binding.descriptorCount;
+        }
+
+        const VkDescriptorUpdateTemplateCreateInfo template_info {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size()),
+            .pDescriptorUpdateEntries = entries.data(),
+            .templateType = p_type,
+            .descriptorSetLayout = p_layout,
+            .pipelineBindPoint = p_bind_point,
+            .pipelineLayout = p_pipeline_layout,
+            .set = p_set,
+        };
+
+        const auto result = vkCreateDescriptorUpdateTemplate(m_device, &template_info, nullptr, &m_template);
+        if (result != VK_SUCCESS) {
+            throw vulkan_creation_exception_t{result, "descriptor update template"};
+        }
+    }
+
+    auto descriptor_update_template_t::update(VkDescriptorSet p_set, const void* p_data) const noexcept -> void {
+        vkUpdateDescriptorSetWithTemplate(m_device, p_set, m_template, p_data);
+    }
+
+    auto descriptor_update_template_t::push(VkCommandBuffer p_command_buffer, const void* p_data) const noexcept -> void {
+        m_device.push_descriptor_set_with_template(p_command_buffer, m_template, m_pipeline_layout, m_set, p_data);
+    }
+
+    descriptor_pool_t::descriptor_pool_t(const device_t& p_device, std::span<const VkDescriptorPoolSize> p_sizes, uint32_t p_max_sets, VkDescriptorPoolCreateFlags p_flags) :
         m_device(p_device)
     {
         const VkDescriptorPoolCreateInfo pool_info {
             .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
             .pNext = nullptr,
-            .flags = 0,
+            .flags = p_flags,
             .maxSets = p_max_sets,
             .poolSizeCount = static_cast<uint32_t>(p_sizes.size()),
             .pPoolSizes = p_sizes.data()
@@ -55,4 +161,80 @@ namespace pooper_cube {
 
         return set;
     }
+
+    auto descriptor_pool_t::reset() const noexcept -> void {
+        vkResetDescriptorPool(m_device, m_pool, 0);
+    }
+
+    descriptor_allocator_t::descriptor_allocator_t(const device_t& p_device, std::span<const VkDescriptorPoolSize> p_pool_sizes, uint32_t p_sets_per_pool) :
+        m_device(p_device),
+        m_pool_sizes(p_pool_sizes.begin(), p_pool_sizes.end()),
+        m_sets_per_pool(p_sets_per_pool),
+        m_pools{},
+        m_current_pool(0)
+    {
+        m_pools.push_back(std::make_unique<descriptor_pool_t>(m_device, m_pool_sizes, m_sets_per_pool));
+    }
+
+    auto descriptor_allocator_t::allocate(const descriptor_layout_t& p_layout, std::span<VkDescriptorSet> p_sets) -> void {
+        if (p_sets.empty()) {
+            return;
+        }
+
+        const std::vector<VkDescriptorSetLayout> layouts(p_sets.size(), p_layout);
+
+        // Every pool after the current one is empty, one way or another.
+        bool empty_pool = false;
+
+        while (true) {
+            const auto result = try_allocate(*m_pools[m_current_pool], layouts, p_sets);
+            if (result == VK_SUCCESS) {
+                return;
+            }
+
+            // A full (or fragmented) pool just means that it's time to move on to the next
+            // one. Anything else is a real error, and so is running out of room in an empty
+            // pool, since the next one wouldn't be any bigger.
+            if ((result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) || empty_pool) {
+                throw vulkan_creation_exception_t{result, "descriptor set"};
+            }
+
+            m_current_pool++;
+            if (m_current_pool == m_pools.size()) {
+                m_pools.push_back(std::make_unique<descriptor_pool_t>(m_device, m_pool_sizes, m_sets_per_pool));
+            }
+
+            empty_pool = true;
+        }
+    }
+
+    auto descriptor_allocator_t::allocate(const descriptor_layout_t& p_layout) -> VkDescriptorSet {
+        VkDescriptorSet set;
+        allocate(p_layout, std::span{&set, 1});
+        return set;
+    }
+
+    auto descriptor_allocator_t::reset() noexcept -> void {
+        for (size_t i = 0; i <= m_current_pool; i++) {
+            m_pools[i]->reset();
+        }
+
+        m_current_pool = 0;
+    }
+
+    auto descriptor_allocator_t::try_allocate(
+        const descriptor_pool_t& p_pool,
+        std::span<const VkDescriptorSetLayout> p_layouts,
+        std::span<VkDescriptorSet> p_sets
+    ) const -> VkResult {
+        const VkDescriptorSetAllocateInfo allocate_info {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .pNext = nullptr,
+            .descriptorPool = p_pool,
+            .descriptorSetCount = static_cast<uint32_t>(p_sets.size()),
+            .pSetLayouts = p_layouts.data(),
+        };
+
+        return vkAllocateDescriptorSets(m_device, &allocate_info, p_sets.data());
+    }
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <memory>
+
 #include "common.hpp"
 #include "devices.hpp"
 
@@ -8,11 +10,19 @@ namespace pooper_cube {
 
     class descriptor_layout_t {
         public:
-            descriptor_layout_t(const device_t& device, std::span<const VkDescriptorSetLayoutBinding> bindings);
+            // The binding flags are either empty, or one for each of the bindings.
+            descriptor_layout_t(
+                const device_t& device,
+                std::span<const VkDescriptorSetLayoutBinding> bindings,
+                VkDescriptorSetLayoutCreateFlags flags = 0,
+                std::span<const VkDescriptorBindingFlags> binding_flags = {}
+            );
             NO_COPY(descriptor_layout_t);
 
             operator VkDescriptorSetLayout() const noexcept { return m_layout; }
 
+            auto get_bindings() const noexcept -> std::span<const VkDescriptorSetLayoutBinding> { return m_bindings; }
+
             ~descriptor_layout_t() noexcept {
                 vkDestroyDescriptorSetLayout(m_device, m_layout, nullptr);
             }
@@ -20,17 +30,79 @@ namespace pooper_cube {
         private:
             VkDescriptorSetLayout m_layout;
             const device_t& m_device;
+
+            // Kept around for building update templates.
+            std::vector<VkDescriptorSetLayoutBinding> m_bindings;
+    };
+
+    // Writes every binding of a layout in one call, out of a block of memory that holds
+    // the descriptors one after the other, in the order that the layout lists the
+    // bindings. Each descriptor takes up a VkDescriptorBufferInfo, a VkDescriptorImageInfo
+    // or a VkBufferView, depending on its type, so a struct with those as its members is
+    // all it takes. Inline uniform blocks aren't supported.
+    class descriptor_update_template_t {
+        public:
+            // For updating sets that were allocated with the layout.
+            descriptor_update_template_t(const device_t& device, const descriptor_layout_t& layout);
+
+            // For pushing the descriptors straight into a command buffer, as the given set of
+            // the pipeline layout. The layout has to have been created with
+            // VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR, and the device has to
+            // have push descriptors enabled.
+            descriptor_update_template_t(
+                const device_t& device,
+                const descriptor_layout_t& layout,
+                VkPipelineBindPoint bind_point,
+                VkPipelineLayout pipeline_layout,
+                uint32_t set
+            );
+
+            NO_COPY(descriptor_update_template_t);
+
+            operator VkDescriptorUpdateTemplate() const noexcept { return m_template; }
+
+            // How many bytes the data passed to update() and push() has to have.
+            auto get_data_size() const noexcept -> size_t { return m_data_size; }
+
+            auto update(VkDescriptorSet set, const void* data) const noexcept -> void;
+            auto push(VkCommandBuffer command_buffer, const void* data) const noexcept -> void;
+
+            ~descriptor_update_template_t() noexcept {
+                vkDestroyDescriptorUpdateTemplate(m_device, m_template, nullptr);
+            }
+
+        private:
+            descriptor_update_template_t(
+                const device_t& device,
+                const descriptor_layout_t& layout,
+                VkDescriptorUpdateTemplateType type,
+                VkPipelineBindPoint bind_point,
+                VkPipelineLayout pipeline_layout,
+                uint32_t set
+            );
+
+            VkDescriptorUpdateTemplate m_template;
+            const device_t& m_device;
+
+            size_t m_data_size;
+
+            // Only used for pushing.
+            VkPipelineLayout m_pipeline_layout;
+            uint32_t m_set;
     };
 
     class descriptor_pool_t {
         public:
-            descriptor_pool_t(const device_t& device, std::span<const VkDescriptorPoolSize> sizes, uint32_t max_sets);
+            descriptor_pool_t(const device_t& device, std::span<const VkDescriptorPoolSize> sizes, uint32_t max_sets, VkDescriptorPoolCreateFlags flags = 0);
             NO_COPY(descriptor_pool_t);
 
             operator VkDescriptorPool() const noexcept { return m_pool; }
 
             auto allocate_set(const descriptor_layout_t& layout) const -> VkDescriptorSet;
 
+            // Takes back every set that was allocated from the pool at once.
+            auto reset() const noexcept -> void;
+
             ~descriptor_pool_t() noexcept {
                 vkDestroyDescriptorPool(m_device, m_pool, nullptr);
             }
@@ -39,4 +111,40 @@ namespace pooper_cube {
             VkDescriptorPool m_pool;
             const device_t& m_device;
     };
+
+    // Hands out sets from a chain of pools, and starts a new pool whenever the current one
+    // runs out. Sets are never freed one at a time. Instead, reset() takes all of them back
+    // at once, and keeps the pools around for the next round, so once the chain has grown
+    // to fit, nothing gets created or destroyed anymore. Meant to be used for sets that
+    // only live for a single frame, with one allocator per frame in flight.
+    class descriptor_allocator_t {
+        public:
+            // Every pool in the chain gets the same sizes.
+            descriptor_allocator_t(const device_t& device, std::span<const VkDescriptorPoolSize> pool_sizes, uint32_t sets_per_pool);
+            NO_COPY(descriptor_allocator_t);
+
+            // Allocates as many sets as there is room for in the span, all with the same
+            // layout, with a single call if possible. Throws if they don't even fit into an
+            // empty pool. Not thread safe.
+            auto allocate(const descriptor_layout_t& layout, std::span<VkDescriptorSet> sets) -> void;
+
+            auto allocate(const descriptor_layout_t& layout) -> VkDescriptorSet;
+
+            // Must only be called once the GPU is done with every set that was handed out.
+            auto reset() noexcept -> void;
+
+            auto get_pool_count() const noexcept -> size_t { return m_pools.size(); }
+
+        private:
+            auto try_allocate(const descriptor_pool_t& pool, std::span<const VkDescriptorSetLayout> layouts, std::span<VkDescriptorSet> sets) const -> VkResult;
+
+            const device_t& m_device;
+
+            std::vector<VkDescriptorPoolSize> m_pool_sizes;
+            uint32_t m_sets_per_pool;
+
+            // Everything before the current pool is full.
+            std::vector<std::unique_ptr<descriptor_pool_t>> m_pools;
+            size_t m_current_pool;
+    };
 }
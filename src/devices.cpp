@@ -3,54 +3,100 @@
 
 using pooper_cube::device_t;
 
-device_t::device_t(const physical_device_t& p_physical_device) {
+device_t::device_t(const physical_device_t& p_physical_device, bool p_enable_dynamic_rendering, bool p_enable_push_descriptors) :
+    m_dynamic_rendering(p_enable_dynamic_rendering && p_physical_device.supports_dynamic_rendering),
+    m_push_descriptor_set_with_template(nullptr)
+{
     std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
 
     const float queue_priority = 1.0f;
 
-    if (p_physical_device.graphics_queue_family == p_physical_device.present_queue_family) {
+    // Any of the queue families may well be the same one, but each family can only be
+    // requested once.
+    const std::array<uint32_t, 4> queue_families {
+        p_physical_device.graphics_queue_family,
+        p_physical_device.present_queue_family,
+        p_physical_device.transfer_queue_family,
+        p_physical_device.compute_queue_family,
+    };
+
+    for (auto family = queue_families.begin(); family != queue_families.end(); family++) {
+        if (std::find(queue_families.begin(), family, *family) != family) {
+            continue;
+        }
+
         queue_create_infos.push_back(
             VkDeviceQueueCreateInfo {
                 .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
                 .pNext = nullptr,
                 .flags = 0,
-                .queueFamilyIndex = p_physical_device.graphics_queue_family,
+                .queueFamilyIndex = *family,
                 .queueCount = 1,
                 .pQueuePriorities = &queue_priority,
             }
         );
-    } else {
-        VkDeviceQueueCreateInfo queue_create_info {
-            .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-            .pNext = nullptr,
-            .flags = 0,
-            .queueFamilyIndex = p_physical_device.graphics_queue_family,
-            .queueCount = 1,
-            .pQueuePriorities = &queue_priority,
-        };
+    }
+
+    const bool push_descriptors = p_enable_push_descriptors && p_physical_device.supports_push_descriptors;
 
-        queue_create_infos.push_back(queue_create_info);
-        queue_create_info.queueFamilyIndex = p_physical_device.present_queue_family;
-        queue_create_infos.push_back(queue_create_info);
+    std::vector<const char*> enabled_extensions;
+
+    if (p_physical_device.can_present) {
+        enabled_extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
     }
 
-    const char* const enabled_extensions[1] = {
-        VK_KHR_SWAPCHAIN_EXTENSION_NAME,
-    };
+    if (push_descriptors) {
+        enabled_extensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+    }
 
-    const VkPhysicalDeviceFeatures enabled_features{};
+    VkPhysicalDeviceFeatures supported_features;
+    vkGetPhysicalDeviceFeatures(p_physical_device, &supported_features);
+
+    // These are only needed by the profiler, but they don't cost anything when no
+    // queries are made, so we might as well turn them on whenever they're there.
+    m_enabled_features = VkPhysicalDeviceFeatures{};
+    m_enabled_features.pipelineStatisticsQuery = supported_features.pipelineStatisticsQuery;
+    m_enabled_features.inheritedQueries = supported_features.inheritedQueries;
+
+    // The bindless table is indexed with push constants.
+    m_enabled_features.shaderStorageBufferArrayDynamicIndexing = VK_TRUE;
+    m_enabled_features.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+
+    // Every submission signals a timeline semaphore, and everything that isn't a uniform
+    // goes through the bindless table. choose_physical_device has already made sure that
+    // all of this is supported.
+    VkPhysicalDeviceVulkan12Features vulkan_12_features{};
+    vulkan_12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan_12_features.pNext = nullptr;
+    vulkan_12_features.timelineSemaphore = VK_TRUE;
+    vulkan_12_features.runtimeDescriptorArray = VK_TRUE;
+    vulkan_12_features.descriptorBindingPartiallyBound = VK_TRUE;
+    vulkan_12_features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    vulkan_12_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    vulkan_12_features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+
+    VkPhysicalDeviceVulkan13Features vulkan_13_features{};
+    vulkan_13_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    vulkan_13_features.pNext = nullptr;
+    vulkan_13_features.dynamicRendering = VK_TRUE;
+
+    // A device that is older than 1.3 doesn't know what to do with the 1.3 features at
+    // all, so they're only chained in when they're actually wanted.
+    if (m_dynamic_rendering) {
+        vulkan_12_features.pNext = &vulkan_13_features;
+    }
 
     const VkDeviceCreateInfo device_info {
         .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-        .pNext = nullptr,
+        .pNext = &vulkan_12_features,
         .flags = 0,
         .queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size()),
         .pQueueCreateInfos = queue_create_infos.data(),
         .enabledLayerCount = 0,
         .ppEnabledLayerNames = nullptr,
-        .enabledExtensionCount = 1,
-        .ppEnabledExtensionNames = enabled_extensions,
-        .pEnabledFeatures = &enabled_features,
+        .enabledExtensionCount = static_cast<uint32_t>(enabled_extensions.size()),
+        .ppEnabledExtensionNames = enabled_extensions.data(),
+        .pEnabledFeatures = &m_enabled_features,
     };
 
     const auto result = vkCreateDevice(p_physical_device, &device_info, nullptr, &m_device);
@@ -60,6 +106,129 @@ device_t::device_t(const physical_device_t& p_physical_device) {
 
     vkGetDeviceQueue(m_device, p_physical_device.graphics_queue_family, 0, &m_graphics_queue);
     vkGetDeviceQueue(m_device, p_physical_device.present_queue_family, 0, &m_present_queue);
+    vkGetDeviceQueue(m_device, p_physical_device.transfer_queue_family, 0, &m_transfer_queue);
+    vkGetDeviceQueue(m_device, p_physical_device.compute_queue_family, 0, &m_compute_queue);
+
+    // If the lookup fails for whatever reason, we just carry on without push descriptors.
+    if (push_descriptors) {
+        m_push_descriptor_set_with_template = reinterpret_cast<PFN_vkCmdPushDescriptorSetWithTemplateKHR>(
+            vkGetDeviceProcAddr(m_device, "vkCmdPushDescriptorSetWithTemplateKHR")
+        );
+    }
+}
+
+namespace {
+    auto find_transfer_family(const std::vector<VkQueueFamilyProperties>& p_queue_families, uint32_t p_graphics_family) -> uint32_t {
+        std::optional<uint32_t> fallback;
+
+        for (uint32_t i = 0; i < p_queue_families.size(); i++) {
+            const auto flags = p_queue_families[i].queueFlags;
+            if ((flags & VK_QUEUE_TRANSFER_BIT) == 0 || (flags & VK_QUEUE_GRAPHICS_BIT) != 0) {
+                continue;
+            }
+
+            // A family that can do nothing but transfers is most likely backed by a
+            // dedicated copy engine, which is exactly what we want.
+            if ((flags & VK_QUEUE_COMPUTE_BIT) == 0) {
+                return i;
+            }
+
+            if (!fallback.has_value()) {
+                fallback = i;
+            }
+        }
+
+        // Graphics queues can always do transfers as well, even if they don't say so.
+        return fallback.value_or(p_graphics_family);
+    }
+
+    auto find_compute_family(const std::vector<VkQueueFamilyProperties>& p_queue_families, uint32_t p_graphics_family) -> uint32_t {
+        // Every device that can do graphics has a queue family that can do compute as well,
+        // and in practice that's always the graphics queue family, so it's fine as a
+        // fallback.
+        for (uint32_t i = 0; i < p_queue_families.size(); i++) {
+            const auto flags = p_queue_families[i].queueFlags;
+            if ((flags & VK_QUEUE_COMPUTE_BIT) != 0 && (flags & VK_QUEUE_GRAPHICS_BIT) == 0) {
+                return i;
+            }
+        }
+
+        return p_graphics_family;
+    }
+
+    auto supports_required_features(VkPhysicalDevice p_physical_device) -> bool {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(p_physical_device, &properties);
+
+        // The instance may well be newer than the device, in which case we can't use
+        // anything past what the device supports.
+        if (properties.apiVersion < VK_API_VERSION_1_2) {
+            return false;
+        }
+
+        VkPhysicalDeviceVulkan12Features vulkan_12_features{};
+        vulkan_12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        vulkan_12_features.pNext = nullptr;
+
+        VkPhysicalDeviceFeatures2 features {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+            .pNext = &vulkan_12_features,
+            .features = VkPhysicalDeviceFeatures{},
+        };
+        vkGetPhysicalDeviceFeatures2(p_physical_device, &features);
+
+        const auto& core_features = features.features;
+
+        return
+            vulkan_12_features.timelineSemaphore == VK_TRUE &&
+            vulkan_12_features.runtimeDescriptorArray == VK_TRUE &&
+            vulkan_12_features.descriptorBindingPartiallyBound == VK_TRUE &&
+            vulkan_12_features.descriptorBindingStorageBufferUpdateAfterBind == VK_TRUE &&
+            vulkan_12_features.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE &&
+            vulkan_12_features.descriptorBindingUpdateUnusedWhilePending == VK_TRUE &&
+            core_features.shaderStorageBufferArrayDynamicIndexing == VK_TRUE &&
+            core_features.shaderSampledImageArrayDynamicIndexing == VK_TRUE;
+    }
+
+    auto supports_dynamic_rendering(VkPhysicalDevice p_physical_device) -> bool {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(p_physical_device, &properties);
+
+        // Only the core version is used, not VK_KHR_dynamic_rendering, so 1.2 devices
+        // stick to render passes.
+        if (properties.apiVersion < VK_API_VERSION_1_3) {
+            return false;
+        }
+
+        VkPhysicalDeviceVulkan13Features vulkan_13_features{};
+        vulkan_13_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+        vulkan_13_features.pNext = nullptr;
+
+        VkPhysicalDeviceFeatures2 features {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+            .pNext = &vulkan_13_features,
+            .features = VkPhysicalDeviceFeatures{},
+        };
+        vkGetPhysicalDeviceFeatures2(p_physical_device, &features);
+
+        return vulkan_13_features.dynamicRendering == VK_TRUE;
+    }
+
+    auto supports_push_descriptors(VkPhysicalDevice p_physical_device) -> bool {
+        uint32_t extension_count;
+        vkEnumerateDeviceExtensionProperties(p_physical_device, nullptr, &extension_count, nullptr);
+
+        std::vector<VkExtensionProperties> extensions(extension_count);
+        vkEnumerateDeviceExtensionProperties(p_physical_device, nullptr, &extension_count, extensions.data());
+
+        for (const auto& extension : extensions) {
+            if (std::strcmp(extension.extensionName, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME) == 0) {
+                return true;
+            }
+        }
+
+        return false;
+    }
 }
 
 auto pooper_cube::choose_physical_device(VkInstance p_instance, VkSurfaceKHR p_surface) -> physical_device_t {
@@ -69,6 +238,8 @@ auto pooper_cube::choose_physical_device(VkInstance p_instance, VkSurfaceKHR p_s
     std::vector<VkPhysicalDevice> physical_devices(device_count);
     vkEnumeratePhysicalDevices(p_instance, &device_count, physical_devices.data());
 
+    const bool headless = p_surface == VK_NULL_HANDLE;
+
     // A better approach would be to rank the devices and choose the best one, but for
     // now, this approach (choosing the first one that fulfills our requirements) should
     // do the job.
@@ -77,6 +248,13 @@ auto pooper_cube::choose_physical_device(VkInstance p_instance, VkSurfaceKHR p_s
         // Normally, I would exclude CPU implementations of Vulkan, but now that I think about it
         // , there really isn't much point to doing so.
 
+        // All of the synchronization between the CPU and the GPU goes through timeline
+        // semaphores, and all of the resources through the bindless table, so we can't do
+        // without either.
+        if (!supports_required_features(physical_device)) {
+            continue;
+        }
+
         uint32_t queue_family_count;
         vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queue_family_count, nullptr);
 
@@ -96,6 +274,16 @@ auto pooper_cube::choose_physical_device(VkInstance p_instance, VkSurfaceKHR p_s
                 graphics_family = i;
             }
 
+            if (headless) {
+                if (graphics_family.has_value()) {
+                    present_family = graphics_family;
+                    break;
+                }
+
+                ++i;
+                continue;
+            }
+
             VkBool32 supports_presentation;
             vkGetPhysicalDeviceSurfaceSupportKHR(physical_device, i, p_surface, &supports_presentation);
             if (supports_presentation == VK_TRUE) {
@@ -116,6 +304,21 @@ auto pooper_cube::choose_physical_device(VkInstance p_instance, VkSurfaceKHR p_s
             continue;
         }
 
+        // Without a surface there is nothing to present to, so we don't care about
+        // swap chain support at all.
+        if (headless) {
+            return physical_device_t{
+                physical_device,
+                graphics_family.value(),
+                present_family.value(),
+                find_transfer_family(queue_families, graphics_family.value()),
+                find_compute_family(queue_families, graphics_family.value()),
+                false,
+                supports_dynamic_rendering(physical_device),
+                supports_push_descriptors(physical_device)
+            };
+        }
+
         uint32_t device_extension_count;
         vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &device_extension_count, nullptr);
 
@@ -127,7 +330,7 @@ auto pooper_cube::choose_physical_device(VkInstance p_instance, VkSurfaceKHR p_s
         std::vector<VkExtensionProperties> device_extensions(device_extension_count);
         vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &device_extension_count, device_extensions.data());
 
-        bool has_swapchain_extension;
+        bool has_swapchain_extension = false;
         for (const auto& extension : device_extensions) {
             if (std::strcmp(extension.extensionName, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0) {
                 has_swapchain_extension = true;
@@ -153,7 +356,16 @@ auto pooper_cube::choose_physical_device(VkInstance p_instance, VkSurfaceKHR p_s
             continue;
         }
 
-        return physical_device_t{physical_device, graphics_family.value(), present_family.value()};
+        return physical_device_t{
+            physical_device,
+            graphics_family.value(),
+            present_family.value(),
+            find_transfer_family(queue_families, graphics_family.value()),
+            find_compute_family(queue_families, graphics_family.value()),
+            true,
+            supports_dynamic_rendering(physical_device),
+            supports_push_descriptors(physical_device)
+        };
     }
 
     throw no_adequate_physical_device_exception_t{};
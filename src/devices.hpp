@@ -6,12 +6,34 @@ namespace pooper_cube {
         uint32_t graphics_queue_family;
         uint32_t present_queue_family;
 
+        // A queue family that only does transfers (i.e. the DMA engines), if the device has
+        // one. Otherwise, it's the same as the graphics queue family.
+        uint32_t transfer_queue_family;
+
+        // Preferably a queue family that can do compute but not graphics, so that compute
+        // work can run alongside the rendering. Otherwise, it's the graphics queue family.
+        uint32_t compute_queue_family;
+
+        // False when the device was chosen without a surface (i.e. for headless rendering).
+        // In that case, the present queue family is just the graphics queue family.
+        bool can_present;
+
+        // Whether the device supports Vulkan 1.3's dynamic rendering, which lets us draw
+        // without a render pass or framebuffers.
+        bool supports_dynamic_rendering;
+
+        // Whether the device has VK_KHR_push_descriptor, which lets descriptors be
+        // recorded straight into a command buffer instead of being written to a set.
+        bool supports_push_descriptors;
+
         operator VkPhysicalDevice() const noexcept { return handle; }
     };
 
     class device_t {
         public:
-            explicit device_t(const physical_device_t& physical_device);
+            // Dynamic rendering and push descriptors are only turned on if the physical
+            // device supports them.
+            explicit device_t(const physical_device_t& physical_device, bool enable_dynamic_rendering = false, bool enable_push_descriptors = false);
 
             device_t(const device_t&) = delete;
             auto operator=(const device_t&) = delete;
@@ -22,15 +44,48 @@ namespace pooper_cube {
 
             auto get_present_queue() const noexcept { return m_present_queue; }
 
+            auto get_transfer_queue() const noexcept { return m_transfer_queue; }
+
+            auto get_compute_queue() const noexcept { return m_compute_queue; }
+
+            auto get_enabled_features() const noexcept -> const VkPhysicalDeviceFeatures& { return m_enabled_features; }
+
+            auto has_dynamic_rendering() const noexcept -> bool { return m_dynamic_rendering; }
+
+            auto has_push_descriptors() const noexcept -> bool { return m_push_descriptor_set_with_template != nullptr; }
+
+            // vkCmdPushDescriptorSetWithTemplateKHR, which comes from an extension, so it
+            // has to be looked up. Must only be called if has_push_descriptors() is true.
+            auto push_descriptor_set_with_template(
+                VkCommandBuffer command_buffer,
+                VkDescriptorUpdateTemplate update_template,
+                VkPipelineLayout layout,
+                uint32_t set,
+                const void* data
+            ) const noexcept -> void {
+                m_push_descriptor_set_with_template(command_buffer, update_template, layout, set, data);
+            }
+
             ~device_t() noexcept { vkDestroyDevice(m_device, nullptr); }
 
         private:
             VkDevice m_device;
             VkQueue m_graphics_queue;
             VkQueue m_present_queue;
+            VkQueue m_transfer_queue;
+            VkQueue m_compute_queue;
+
+            VkPhysicalDeviceFeatures m_enabled_features;
+            bool m_dynamic_rendering;
+
+            // Null unless push descriptors are enabled.
+            PFN_vkCmdPushDescriptorSetWithTemplateKHR m_push_descriptor_set_with_template;
     };
 
     struct no_adequate_physical_device_exception_t {};
 
-    auto choose_physical_device(VkInstance p_instance, VkSurfaceKHR p_surface) -> physical_device_t; 
+    // Passing a null surface selects a device for headless rendering, which does not
+    // need to be able to present anything. Only devices that support Vulkan 1.2, timeline
+    // semaphores and update-after-bind descriptor indexing are considered.
+    auto choose_physical_device(VkInstance p_instance, VkSurfaceKHR p_surface = VK_NULL_HANDLE) -> physical_device_t; 
 }
@@ -0,0 +1,125 @@
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "file-watcher.hpp"
+
+using pooper_cube::file_watcher_t;
+
+namespace {
+    auto add_unique(std::vector<std::string>& p_names, std::string p_name) -> void {
+        if (std::find(p_names.begin(), p_names.end(), p_name) == p_names.end()) {
+            p_names.push_back(std::move(p_name));
+        }
+    }
+}
+
+#ifdef __linux__
+
+file_watcher_t::file_watcher_t(std::filesystem::path p_directory) :
+    m_directory(std::move(p_directory)),
+    m_inotify(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+{
+    // Watching files is a nice to have, so a failure here isn't worth stopping for.
+    if (m_inotify < 0) {
+        fmt::print(stderr, fmt::fg(fmt::color::yellow), "[WARNING]: Failed to set up inotify, changes to {} won't be noticed.\n", m_directory.string());
+        return;
+    }
+
+    // Editors and compilers tend to either write the file in place, or write a new one and
+    // move it over the old one, so both of those have to be caught. Only looking at closed
+    // files means that we don't see them while they're half written.
+    if (inotify_add_watch(m_inotify, m_directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        fmt::print(stderr, fmt::fg(fmt::color::yellow), "[WARNING]: Failed to watch {}, changes to it won't be noticed.\n", m_directory.string());
+        close(m_inotify);
+        m_inotify = -1;
+    }
+}
+
+auto file_watcher_t::poll() -> std::vector<std::string> {
+    std::vector<std::string> changed;
+
+    if (m_inotify < 0) {
+        return changed;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+
+    while (true) {
+        const auto length = read(m_inotify, buffer, sizeof(buffer));
+
+        // With a non-blocking descriptor, EAGAIN just means that there's nothing left.
+        if (length <= 0) {
+            break;
+        }
+
+        for (ssize_t offset = 0; offset < length;) {
+            const auto event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            if (event->len > 0) {
+                add_unique(changed, event->name);
+            }
+
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        }
+    }
+
+    return changed;
+}
+
+file_watcher_t::~file_watcher_t() noexcept {
+    // Closing the descriptor takes the watch with it.
+    if (m_inotify >= 0) {
+        close(m_inotify);
+    }
+}
+
+#else
+
+file_watcher_t::file_watcher_t(std::filesystem::path p_directory) :
+    m_directory(std::move(p_directory)),
+    m_last_scan(std::chrono::steady_clock::now())
+{
+    m_write_times = scan();
+}
+
+auto file_watcher_t::scan() -> std::unordered_map<std::string, std::filesystem::file_time_type> {
+    std::unordered_map<std::string, std::filesystem::file_time_type> write_times;
+
+    // Files can disappear in the middle of this, which is why none of it throws.
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator{m_directory, error}) {
+        const auto write_time = entry.last_write_time(error);
+        if (!error && entry.is_regular_file(error)) {
+            write_times.emplace(entry.path().filename().string(), write_time);
+        }
+    }
+
+    return write_times;
+}
+
+auto file_watcher_t::poll() -> std::vector<std::string> {
+    std::vector<std::string> changed;
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now - m_last_scan < scan_interval) {
+        return changed;
+    }
+
+    m_last_scan = now;
+
+    auto write_times = scan();
+    for (const auto& [name, write_time] : write_times) {
+        const auto previous = m_write_times.find(name);
+        if (previous == m_write_times.end() || previous->second != write_time) {
+            add_unique(changed, name);
+        }
+    }
+
+    m_write_times = std::move(write_times);
+    return changed;
+}
+
+file_watcher_t::~file_watcher_t() noexcept {}
+
+#endif
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <unordered_map>
+
+#include "common.hpp"
+
+namespace pooper_cube {
+    // Finds out when the files in a directory get written to. Uses inotify on Linux, and
+    // falls back to looking at the modification times every now and then everywhere else.
+    // Subdirectories aren't watched.
+    class file_watcher_t {
+        public:
+            explicit file_watcher_t(std::filesystem::path directory);
+            NO_COPY(file_watcher_t);
+
+            // Never blocks. Returns the names (not the paths) of the files that have changed
+            // since the last call, each of them once.
+            auto poll() -> std::vector<std::string>;
+
+            ~file_watcher_t() noexcept;
+
+        private:
+            std::filesystem::path m_directory;
+
+#ifdef __linux__
+            // Negative if inotify couldn't be set up, in which case nothing is ever reported.
+            int m_inotify;
+#else
+            // Looking at every file in the directory isn't free, so it's only done this often.
+            static constexpr auto scan_interval = std::chrono::milliseconds{500};
+
+            auto scan() -> std::unordered_map<std::string, std::filesystem::file_time_type>;
+
+            std::unordered_map<std::string, std::filesystem::file_time_type> m_write_times;
+            std::chrono::steady_clock::time_point m_last_scan;
+#endif
+    };
+}
@@ -0,0 +1,76 @@
+#include <cmath>
+#include <thread>
+
+#include "frame-pacing.hpp"
+
+using pooper_cube::frame_limiter_t;
+using pooper_cube::frame_pacing_t;
+
+frame_limiter_t::frame_limiter_t(double p_frames_per_second) :
+    m_frame_duration(std::chrono::duration_cast<clock_t::duration>(std::chrono::duration<double>(1.0 / p_frames_per_second))),
+    m_next_frame(clock_t::now())
+{}
+
+auto frame_limiter_t::wait() -> void {
+    const auto now = clock_t::now();
+
+    if (now < m_next_frame) {
+        if (m_next_frame - now > spin_time) {
+            std::this_thread::sleep_until(m_next_frame - spin_time);
+        }
+
+        // Burns a core for a moment, but it's the only way to hit the deadline precisely.
+        while (clock_t::now() < m_next_frame) {}
+    } else if (now - m_next_frame > m_frame_duration) {
+        // We've fallen behind by more than a frame (because of a hitch, or because the GPU
+        // can't keep up), and rushing the next few frames out to catch up would only make
+        // the pacing worse.
+        m_next_frame = now;
+    }
+
+    m_next_frame += m_frame_duration;
+}
+
+frame_pacing_t::frame_pacing_t() :
+    m_last_frame{},
+    m_frame_count(0),
+    m_delta_count(0),
+    m_mean(0.0),
+    m_squared_distance_sum(0.0),
+    m_min(std::numeric_limits<double>::max()),
+    m_max(0.0)
+{}
+
+auto frame_pacing_t::mark_frame() -> void {
+    const auto now = clock_t::now();
+    m_frame_count++;
+
+    if (m_last_frame.has_value()) {
+        const auto delta = std::chrono::duration<double, std::milli>(now - m_last_frame.value()).count();
+
+        m_delta_count++;
+        const auto distance = delta - m_mean;
+        m_mean += distance / static_cast<double>(m_delta_count);
+        m_squared_distance_sum += distance * (delta - m_mean);
+
+        m_min = std::min(m_min, delta);
+        m_max = std::max(m_max, delta);
+    }
+
+    m_last_frame = now;
+}
+
+auto frame_pacing_t::print_report() const -> void {
+    if (m_delta_count < 2) {
+        return;
+    }
+
+    const auto variance = m_squared_distance_sum / static_cast<double>(m_delta_count - 1);
+
+    fmt::print(
+        stderr,
+        "[INFO]: Frame pacing over {} frames: {:.3f} ms between frames on average (from {:.3f} to {:.3f} ms), "
+        "with a variance of {:.4f} ms^2 (a standard deviation of {:.3f} ms).\n",
+        m_frame_count, m_mean, m_min, m_max, variance, std::sqrt(variance)
+    );
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+
+#include "common.hpp"
+
+namespace pooper_cube {
+    // Keeps the render loop from going faster than a given frame rate, independently of
+    // the present mode. Sleeping alone isn't precise enough for this (the OS tends to wake
+    // us up a millisecond or two late), so it sleeps for most of the wait and then spins
+    // for the rest.
+    class frame_limiter_t {
+        public:
+            explicit frame_limiter_t(double frames_per_second);
+            NO_COPY(frame_limiter_t);
+
+            // Blocks until it's time to start the next frame.
+            auto wait() -> void;
+
+        private:
+            using clock_t = std::chrono::steady_clock;
+
+            // Anything closer than this to the deadline is spun away instead of slept.
+            static constexpr auto spin_time = std::chrono::microseconds{2000};
+
+            clock_t::duration m_frame_duration;
+            clock_t::time_point m_next_frame;
+    };
+
+    // Measures how evenly the frames are spaced out. A steady frame rate with a low
+    // variance looks a lot smoother than a higher one that jumps around.
+    class frame_pacing_t {
+        public:
+            frame_pacing_t();
+            NO_COPY(frame_pacing_t);
+
+            // Should be called at the same point of every frame.
+            auto mark_frame() -> void;
+
+            // Leaves the time until the next frame out, for when frames aren't being
+            // rendered on purpose (while the window is minimized, for example).
+            auto pause() noexcept -> void { m_last_frame.reset(); }
+
+            // Prints the mean and the variance of the time between frames to stderr.
+            auto print_report() const -> void;
+
+        private:
+            using clock_t = std::chrono::steady_clock;
+
+            std::optional<clock_t::time_point> m_last_frame;
+
+            // Counted separately from the deltas, since the first frame after a pause
+            // doesn't add one.
+            uint64_t m_frame_count;
+
+            // The deltas are in milliseconds. The variance is kept track of with Welford's
+            // algorithm, so that none of the deltas have to be kept around.
+            uint64_t m_delta_count;
+            double m_mean;
+            double m_squared_distance_sum;
+            double m_min;
+            double m_max;
+    };
+}
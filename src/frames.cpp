@@ -0,0 +1,68 @@
+#include "frames.hpp"
+
+using pooper_cube::frame_t;
+using pooper_cube::frame_ring_t;
+
+frame_t::frame_t(
+    uint32_t p_index,
+    const physical_device_t& p_physical_device,
+    const device_t& p_device,
+    submission_tracker_t& p_submissions,
+    const command_pool_t& p_command_pool,
+    uint32_t p_secondary_command_buffer_count
+) :
+    m_submissions(p_submissions),
+    m_index(p_index),
+    m_command_buffer(p_command_pool.allocate_command_buffer()),
+    m_acquired_image_semaphore(p_device),
+    // Nothing to wait for the first time around.
+    m_last_submission{queue_kind_t::graphics, 0}
+{
+    m_secondary_command_pools.reserve(p_secondary_command_buffer_count);
+    m_secondary_command_buffers.reserve(p_secondary_command_buffer_count);
+
+    for (uint32_t i = 0; i < p_secondary_command_buffer_count; i++) {
+        const auto& pool = m_secondary_command_pools.emplace_back(
+            std::make_unique<command_pool_t>(p_device, p_physical_device.graphics_queue_family)
+        );
+
+        m_secondary_command_buffers.push_back(pool->allocate_command_buffer(VK_COMMAND_BUFFER_LEVEL_SECONDARY));
+    }
+}
+
+auto frame_t::wait() const -> void {
+    m_submissions.wait(m_last_submission);
+}
+
+auto frame_t::reset() const -> void {
+    const auto result = vkResetCommandBuffer(m_command_buffer, 0);
+    if (result != VK_SUCCESS) {
+        throw generic_vulkan_exception_t{result, "Failed to reset the command buffer of a frame."};
+    }
+
+    for (const auto& pool : m_secondary_command_pools) {
+        pool->reset();
+    }
+}
+
+frame_ring_t::frame_ring_t(
+    uint32_t p_frame_count,
+    const physical_device_t& p_physical_device,
+    const device_t& p_device,
+    submission_tracker_t& p_submissions,
+    const command_pool_t& p_command_pool,
+    uint32_t p_secondary_command_buffer_count
+) : m_current(0) {
+    m_frames.reserve(p_frame_count);
+
+    for (uint32_t i = 0; i < p_frame_count; i++) {
+        m_frames.push_back(std::make_unique<frame_t>(
+            i,
+            p_physical_device,
+            p_device,
+            p_submissions,
+            p_command_pool,
+            p_secondary_command_buffer_count
+        ));
+    }
+}
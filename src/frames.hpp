@@ -0,0 +1,96 @@
+#pragma once
+
+#include <memory>
+
+#include "common.hpp"
+#include "devices.hpp"
+#include "commands.hpp"
+#include "submissions.hpp"
+#include "sync-objects.hpp"
+
+namespace pooper_cube {
+    // Everything that a single frame needs to own while the GPU is working on it.
+    // Nothing in here may be touched by the CPU again until its last submission retires.
+    class frame_t {
+        public:
+            frame_t(
+                uint32_t index,
+                const physical_device_t& physical_device,
+                const device_t& device,
+                submission_tracker_t& submissions,
+                const command_pool_t& command_pool,
+                uint32_t secondary_command_buffer_count
+            );
+
+            NO_COPY(frame_t);
+
+            // Blocks until the GPU has finished the last submission that used this frame.
+            auto wait() const -> void;
+
+            // Resets the command buffers, so that they can be recorded again. Must only be
+            // called after wait().
+            auto reset() const -> void;
+
+            // Has to be called with whatever the frame got submitted as, so that the next
+            // wait() knows what to wait for.
+            auto set_submission(submission_t submission) noexcept -> void { m_last_submission = submission; }
+
+            // The position of the frame in its ring.
+            auto get_index() const noexcept -> uint32_t { return m_index; }
+
+            auto get_command_buffer() const noexcept -> VkCommandBuffer { return m_command_buffer; }
+
+            // Each of these comes from its own pool, so that they can all be recorded on
+            // different threads at the same time.
+            auto get_secondary_command_buffers() const noexcept -> std::span<const VkCommandBuffer> { return m_secondary_command_buffers; }
+
+            // The semaphore that presenting waits on belongs to the swap chain image instead,
+            // since the present can still be waiting on it after the frame has finished.
+            auto get_acquired_image_semaphore() const noexcept -> const semaphore_t& { return m_acquired_image_semaphore; }
+
+        private:
+            submission_tracker_t& m_submissions;
+            uint32_t m_index;
+
+            VkCommandBuffer m_command_buffer;
+
+            std::vector<std::unique_ptr<command_pool_t>> m_secondary_command_pools;
+            std::vector<VkCommandBuffer> m_secondary_command_buffers;
+
+            semaphore_t m_acquired_image_semaphore;
+
+            submission_t m_last_submission;
+    };
+
+    // A fixed ring of frames. The render loop always works on the current frame,
+    // and moves on to the next one once it has submitted it.
+    class frame_ring_t {
+        public:
+            frame_ring_t(
+                uint32_t frame_count,
+                const physical_device_t& physical_device,
+                const device_t& device,
+                submission_tracker_t& submissions,
+                const command_pool_t& command_pool,
+                uint32_t secondary_command_buffer_count
+            );
+
+            NO_COPY(frame_ring_t);
+
+            auto current() noexcept -> frame_t& { return *m_frames[m_current]; }
+            auto current() const noexcept -> const frame_t& { return *m_frames[m_current]; }
+
+            auto current_index() const noexcept -> uint32_t { return m_current; }
+
+            auto operator[](uint32_t index) const noexcept -> const frame_t& { return *m_frames[index]; }
+
+            auto advance() noexcept -> void { m_current = (m_current + 1) % m_frames.size(); }
+
+            auto size() const noexcept -> uint32_t { return static_cast<uint32_t>(m_frames.size()); }
+
+        private:
+            // The frames themselves cannot be moved around, as they hold references.
+            std::vector<std::unique_ptr<frame_t>> m_frames;
+            uint32_t m_current;
+    };
+}
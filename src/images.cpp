@@ -26,7 +26,11 @@ namespace pooper_cube {
         return std::optional<VkFormat>{};
     }
 
-    image_t::image_t(const physical_device_t& p_physical_device, const device_t& p_device, uint32_t p_width, uint32_t p_height, type_t p_type) : m_device(p_device) {
+    image_t::image_t(allocator_t& p_allocator, uint32_t p_width, uint32_t p_height, type_t p_type) :
+        m_allocation{},
+        m_device(p_allocator.get_device()),
+        m_allocator(&p_allocator)
+    {
         VkImageCreateInfo image_info {
             .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
             .pNext = nullptr,
@@ -52,8 +56,8 @@ namespace pooper_cube {
                 image_info.format = VK_FORMAT_R8G8B8A8_SRGB;
                 image_info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
                 break;
-            case type_t::depth_buffer:
-                const auto format = find_depth_format(p_physical_device);
+            case type_t::depth_buffer: {
+                const auto format = find_depth_format(p_allocator.get_physical_device());
                 if (!format.has_value()) {
                     throw generic_vulkan_exception_t{VK_SUCCESS, "There appears to be no usable depth format for some reasons."};
                 }
@@ -61,8 +65,17 @@ namespace pooper_cube {
                 image_info.format = format.value();
                 image_info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
                 break;
+            }
+            case type_t::color_attachment:
+                // Used as the render target when there is no swap chain, so it needs to 
+                // be able to be copied out of as well.
+                image_info.format = VK_FORMAT_R8G8B8A8_SRGB;
+                image_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+                break;
         }
 
+        m_format = image_info.format;
+
         auto result = vkCreateImage(m_device, &image_info, nullptr, &m_image);
         if (result != VK_SUCCESS) {
             throw vulkan_creation_exception_t{result, "image"};
@@ -71,25 +84,20 @@ namespace pooper_cube {
         VkMemoryRequirements memory_requirements;
         vkGetImageMemoryRequirements(m_device, m_image, &memory_requirements);
 
-        const auto memory_type_index = find_memory_type(p_physical_device, memory_requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        if (!memory_type_index.has_value()) {
-            throw generic_vulkan_exception_t{VK_SUCCESS, "Failed to find an adequate memory type for the image."};
+        try {
+            m_allocation = p_allocator.allocate(memory_requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, resource_kind_t::image);
+        } catch (...) {
+            vkDestroyImage(m_device, m_image, nullptr);
+            throw;
         }
 
-        VkMemoryAllocateInfo allocate_info {
-            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-            .pNext = nullptr,
-            .allocationSize = memory_requirements.size,
-            .memoryTypeIndex = memory_type_index.value(),
-        };
-
-        result = vkAllocateMemory(m_device, &allocate_info, nullptr, &m_memory);
+        result = vkBindImageMemory(m_device, m_image, m_allocation.memory, m_allocation.offset);
         if (result != VK_SUCCESS) {
-            throw vulkan_creation_exception_t{result, "memory for image"};
+            vkDestroyImage(m_device, m_image, nullptr);
+            p_allocator.free(m_allocation);
+            throw allocator_t::allocation_exception_t{result, "Failed to bind the memory of an image."};
         }
 
-        vkBindImageMemory(m_device, m_image, m_memory, 0);
-
         const VkImageViewCreateInfo view_info {
             .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
             .pNext = nullptr,
@@ -109,6 +117,7 @@ namespace pooper_cube {
                         case type_t::depth_buffer:
                             return VK_IMAGE_ASPECT_DEPTH_BIT;
                         case type_t::sampled:
+                        case type_t::color_attachment:
                             return VK_IMAGE_ASPECT_COLOR_BIT;
                     }
                 }()),
@@ -126,24 +135,31 @@ namespace pooper_cube {
     }
 
     auto image_t::operator=(image_t&& other) noexcept -> image_t& {
-        vkFreeMemory(m_device, m_memory, nullptr);
         vkDestroyImageView(m_device, m_view, nullptr);
         vkDestroyImage(m_device, m_image, nullptr);
+        if (m_allocator != nullptr) {
+            m_allocator->free(m_allocation);
+        }
 
         m_image = other.m_image;
-        m_memory = other.m_memory;
+        m_allocation = other.m_allocation;
+        m_allocator = other.m_allocator;
         m_view = other.m_view;
+        m_format = other.m_format;
 
         other.m_view = VK_NULL_HANDLE;
-        other.m_memory = VK_NULL_HANDLE;
+        other.m_allocation = allocation_t{};
+        other.m_allocator = nullptr;
         other.m_image = VK_NULL_HANDLE;
 
         return *this;
     }
 
     image_t::~image_t() noexcept {
-        vkFreeMemory(m_device, m_memory, nullptr);
         vkDestroyImageView(m_device, m_view, nullptr);
         vkDestroyImage(m_device, m_image, nullptr);
+        if (m_allocator != nullptr) {
+            m_allocator->free(m_allocation);
+        }
     }
 }
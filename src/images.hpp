@@ -1,25 +1,26 @@
 #pragma once
 
 #include "common.hpp"
+#include "memory.hpp"
 
 namespace pooper_cube {
-    class device_t;
-    struct physical_device_t;
 
     class image_t {
         public:
             enum class type_t {
-                sampled, depth_buffer
+                sampled, depth_buffer, color_attachment
             };
 
             image_t(const device_t& device) :
                 m_image{VK_NULL_HANDLE},
                 m_view{VK_NULL_HANDLE},
-                m_memory{VK_NULL_HANDLE},
-                m_device{device}
+                m_allocation{},
+                m_format{VK_FORMAT_UNDEFINED},
+                m_device{device},
+                m_allocator{nullptr}
             {}
         
-            image_t(const physical_device_t& physical_device, const device_t& device, uint32_t width, uint32_t height, type_t type);
+            image_t(allocator_t& allocator, uint32_t width, uint32_t height, type_t type);
             NO_COPY(image_t);
 
             operator VkImage() const noexcept { return m_image; }
@@ -28,14 +29,20 @@ namespace pooper_cube {
 
             auto get_view() const noexcept { return m_view; }
 
+            auto get_format() const noexcept { return m_format; }
+
             ~image_t() noexcept;
 
         private:
             VkImage m_image;
             VkImageView m_view;
-            VkDeviceMemory m_memory;
+            allocation_t m_allocation;
+            VkFormat m_format;
 
             const device_t& m_device;
+
+            // Null images don't have an allocator.
+            allocator_t* m_allocator;
     };
 
     auto find_depth_format(const physical_device_t& p_physical_device) -> std::optional<VkFormat>; 
@@ -0,0 +1,196 @@
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <utility>
+
+#include "jobs.hpp"
+
+using pooper_cube::job_counter_t;
+using pooper_cube::job_system_t;
+
+namespace {
+    // Which job system the current thread works for, if any, and which of its queues is
+    // the thread's own.
+    thread_local const job_system_t* current_job_system = nullptr;
+    thread_local uint32_t current_queue = 0;
+
+    auto pin_to_core(std::thread& p_thread, uint32_t p_core) -> bool {
+#ifdef __linux__
+        cpu_set_t cores;
+        CPU_ZERO(&cores);
+        CPU_SET(p_core, &cores);
+
+        return pthread_setaffinity_np(p_thread.native_handle(), sizeof(cores), &cores) == 0;
+#else
+        static_cast<void>(p_thread);
+        static_cast<void>(p_core);
+        return false;
+#endif
+    }
+}
+
+job_counter_t::job_counter_t() noexcept :
+    m_pending(0),
+    m_exception(nullptr)
+{}
+
+job_system_t::job_system_t(uint32_t p_worker_count, bool p_pin_threads) :
+    m_queued_jobs(0),
+    m_stopping(false)
+{
+    m_queues.reserve(p_worker_count + 1);
+    for (uint32_t i = 0; i < p_worker_count + 1; i++) {
+        m_queues.push_back(std::make_unique<queue_t>());
+    }
+
+    m_threads.reserve(p_worker_count);
+    for (uint32_t i = 0; i < p_worker_count; i++) {
+        m_threads.emplace_back([this, i]() { work(i); });
+    }
+
+    if (!p_pin_threads) {
+        return;
+    }
+
+    // The first core is left to the main thread, which isn't pinned, but would most likely
+    // end up there anyway.
+    const auto core_count = std::max(std::thread::hardware_concurrency(), 1u);
+
+    for (uint32_t i = 0; i < m_threads.size(); i++) {
+        if (!pin_to_core(m_threads[i], (i + 1) % core_count)) {
+            fmt::print(stderr, fmt::fg(fmt::color::yellow), "[WARNING]: Failed to pin the worker threads to cores, they're left wherever the scheduler puts them.\n");
+            break;
+        }
+    }
+}
+
+auto job_system_t::get_default_worker_count() noexcept -> uint32_t {
+    // Zero means that nobody knows, in which case the main thread has to do it all.
+    const auto core_count = std::thread::hardware_concurrency();
+    return core_count > 1 ? core_count - 1 : 0;
+}
+
+auto job_system_t::get_own_queue() const noexcept -> uint32_t {
+    return current_job_system == this ? current_queue : static_cast<uint32_t>(m_queues.size() - 1);
+}
+
+auto job_system_t::submit(job_t p_job, job_counter_t& p_counter) -> void {
+    p_counter.m_pending.fetch_add(1, std::memory_order_relaxed);
+
+    auto& queue = *m_queues[get_own_queue()];
+    {
+        const std::lock_guard lock{queue.mutex};
+        queue.jobs.push_back(queued_job_t{std::move(p_job), &p_counter});
+    }
+
+    {
+        const std::lock_guard lock{m_sleep_mutex};
+        m_queued_jobs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    m_work_available.notify_one();
+}
+
+auto job_system_t::wait(job_counter_t& p_counter) -> void {
+    const auto own_queue = get_own_queue();
+
+    // The jobs that we're waiting for may well be running on other threads already, in
+    // which case there's nothing for us to do but wait for them to finish. They should be
+    // short, so it isn't worth going to sleep for.
+    while (!p_counter.is_done()) {
+        if (!run_next_job(own_queue)) {
+            std::this_thread::yield();
+        }
+    }
+
+    const std::lock_guard lock{p_counter.m_exception_mutex};
+    if (p_counter.m_exception != nullptr) {
+        std::rethrow_exception(std::exchange(p_counter.m_exception, nullptr));
+    }
+}
+
+auto job_system_t::run_next_job(uint32_t p_own_queue) -> bool {
+    const auto queue_count = static_cast<uint32_t>(m_queues.size());
+    const auto shared_queue = queue_count - 1;
+
+    const auto take = [&](uint32_t p_queue, bool p_newest) -> std::optional<queued_job_t> {
+        auto& queue = *m_queues[p_queue];
+        const std::lock_guard lock{queue.mutex};
+
+        if (queue.jobs.empty()) {
+            return std::optional<queued_job_t>{};
+        }
+
+        auto job = std::move(p_newest ? queue.jobs.back() : queue.jobs.front());
+        if (p_newest) {
+            queue.jobs.pop_back();
+        } else {
+            queue.jobs.pop_front();
+        }
+
+        m_queued_jobs.fetch_sub(1, std::memory_order_relaxed);
+        return job;
+    };
+
+    // The shared queue is first come, first served, like every queue that is stolen from.
+    auto job = take(p_own_queue, p_own_queue != shared_queue);
+
+    for (uint32_t offset = 1; offset < queue_count && !job.has_value(); offset++) {
+        job = take((p_own_queue + offset) % queue_count, false);
+    }
+
+    if (!job.has_value()) {
+        return false;
+    }
+
+    run(job.value());
+    return true;
+}
+
+auto job_system_t::run(queued_job_t& p_job) noexcept -> void {
+    try {
+        p_job.job();
+    } catch (...) {
+        const std::lock_guard lock{p_job.counter->m_exception_mutex};
+        if (p_job.counter->m_exception == nullptr) {
+            p_job.counter->m_exception = std::current_exception();
+        }
+    }
+
+    // Whoever is waiting may destroy the counter as soon as this hits zero, so it can't be
+    // touched after this.
+    p_job.counter->m_pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+auto job_system_t::work(uint32_t p_worker_index) -> void {
+    current_job_system = this;
+    current_queue = p_worker_index;
+
+    while (true) {
+        if (run_next_job(p_worker_index)) {
+            continue;
+        }
+
+        std::unique_lock lock{m_sleep_mutex};
+        m_work_available.wait(lock, [&]() { return m_stopping || m_queued_jobs.load(std::memory_order_relaxed) > 0; });
+
+        if (m_stopping) {
+            return;
+        }
+    }
+}
+
+job_system_t::~job_system_t() noexcept {
+    {
+        const std::lock_guard lock{m_sleep_mutex};
+        m_stopping = true;
+    }
+
+    m_work_available.notify_all();
+
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "common.hpp"
+
+namespace pooper_cube {
+    // Counts the jobs that were submitted with it and haven't finished yet. Also holds on to
+    // the first exception that any of them threw, until somebody waits on it.
+    class job_counter_t {
+        public:
+            job_counter_t() noexcept;
+            NO_COPY(job_counter_t);
+
+            auto is_done() const noexcept -> bool { return m_pending.load(std::memory_order_acquire) == 0; }
+
+        private:
+            friend class job_system_t;
+
+            std::atomic<uint32_t> m_pending;
+
+            std::mutex m_exception_mutex;
+            std::exception_ptr m_exception;
+    };
+
+    // A fixed set of worker threads, each with a queue of its own. Workers take the newest
+    // job from their own queue first, since whatever it needs is most likely still in the
+    // cache, and only when that runs dry do they steal the oldest job from somebody else's.
+    // Jobs submitted from outside of the workers go into a queue that everybody shares.
+    //
+    // Threads that wait on a counter run jobs in the meantime, instead of just sitting there,
+    // so waiting from inside of a job is fine, and so is having no workers at all.
+    class job_system_t {
+        public:
+            using job_t = std::function<void()>;
+
+            // Pinning puts every worker on a core of its own, so the scheduler can't move
+            // them around. Only supported on Linux, and ignored with a warning elsewhere.
+            job_system_t(uint32_t worker_count, bool pin_threads);
+            NO_COPY(job_system_t);
+
+            // One less than there are cores, since the main thread does its share of the
+            // work whenever it waits.
+            static auto get_default_worker_count() noexcept -> uint32_t;
+
+            // The counter must outlive the job, which it does as long as it's waited on.
+            auto submit(job_t job, job_counter_t& counter) -> void;
+
+            // Runs jobs until every job of the counter is done, and rethrows the first
+            // exception that any of them threw.
+            auto wait(job_counter_t& counter) -> void;
+
+            // Calls the function with every range of at most p_grain_size indices out of
+            // [0, p_count), spread over the workers, and returns when all of them are done.
+            template<typename T>
+            auto parallel_for(size_t p_count, size_t p_grain_size, const T& p_function) -> void {
+                const auto grain_size = std::max<size_t>(p_grain_size, 1);
+
+                job_counter_t counter;
+                for (size_t begin = 0; begin < p_count; begin += grain_size) {
+                    const auto end = std::min(begin + grain_size, p_count);
+                    submit([&p_function, begin, end]() { p_function(begin, end); }, counter);
+                }
+
+                wait(counter);
+            }
+
+            // Splits [0, p_count) into about as many ranges as there are threads to run them,
+            // for work that is spread out evenly.
+            template<typename T>
+            auto parallel_for(size_t p_count, const T& p_function) -> void {
+                const size_t thread_count = get_worker_count() + 1;
+                parallel_for(p_count, (p_count + thread_count - 1) / thread_count, p_function);
+            }
+
+            auto get_worker_count() const noexcept -> uint32_t { return static_cast<uint32_t>(m_threads.size()); }
+
+            ~job_system_t() noexcept;
+
+        private:
+            struct queued_job_t {
+                job_t job;
+                job_counter_t* counter;
+            };
+
+            struct queue_t {
+                std::mutex mutex;
+                std::deque<queued_job_t> jobs;
+            };
+
+            auto work(uint32_t worker_index) -> void;
+
+            // The queue that the calling thread owns, or the shared one if it isn't one of
+            // our workers.
+            auto get_own_queue() const noexcept -> uint32_t;
+
+            // Takes a job from the given queue first, and tries stealing one from every
+            // other queue after that. Returns false if there was nothing to be found.
+            auto run_next_job(uint32_t own_queue) -> bool;
+
+            auto run(queued_job_t& job) noexcept -> void;
+
+            // One for every worker, followed by the shared one.
+            std::vector<std::unique_ptr<queue_t>> m_queues;
+            std::vector<std::thread> m_threads;
+
+            // Jobs that are in a queue, and haven't been taken out of it yet. Only ever goes
+            // up with the mutex held, so that no worker can miss a job and go to sleep.
+            std::atomic<uint32_t> m_queued_jobs;
+
+            std::mutex m_sleep_mutex;
+            std::condition_variable m_work_available;
+            bool m_stopping;
+    };
+}
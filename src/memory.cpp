@@ -0,0 +1,321 @@
+#include "memory.hpp"
+
+using pooper_cube::allocator_t;
+using pooper_cube::memory_block_t;
+
+namespace {
+    auto align_up(VkDeviceSize p_value, VkDeviceSize p_alignment) -> VkDeviceSize {
+        // Vulkan guarantees that alignments are always powers of two.
+        return (p_value + p_alignment - 1) & ~(p_alignment - 1);
+    }
+}
+
+namespace pooper_cube {
+    auto find_memory_type(const physical_device_t& p_physical_device, uint32_t p_type_filter, VkMemoryPropertyFlags properties) -> std::optional<uint32_t> {
+        VkPhysicalDeviceMemoryProperties memory_properties;
+        vkGetPhysicalDeviceMemoryProperties(p_physical_device, &memory_properties);
+
+        for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++) {
+            const bool is_suitable = p_type_filter & (1 << i);
+            // Every one of the requested properties has to be there, not just one of them.
+            const bool has_properties = (memory_properties.memoryTypes[i].propertyFlags & properties) == properties;
+
+            if (is_suitable && has_properties) {
+                return i;
+            }
+        }
+
+        return std::optional<uint32_t>{};
+    }
+}
+
+memory_block_t::memory_block_t(
+    const device_t& p_device,
+    uint32_t p_memory_type,
+    VkDeviceSize p_size,
+    bool p_host_visible,
+    resource_kind_t p_kind,
+    allocation_strategy_t p_strategy,
+    bool p_dedicated
+) :
+    m_device(p_device),
+    m_mapped_data(nullptr),
+    m_size(p_size),
+    m_memory_type(p_memory_type),
+    m_kind(p_kind),
+    m_strategy(p_strategy),
+    m_dedicated(p_dedicated),
+    m_head(0),
+    m_used(0),
+    m_allocation_count(0)
+{
+    const VkMemoryAllocateInfo allocate_info {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .pNext = nullptr,
+        .allocationSize = p_size,
+        .memoryTypeIndex = p_memory_type,
+    };
+
+    auto result = vkAllocateMemory(m_device, &allocate_info, nullptr, &m_memory);
+    if (result != VK_SUCCESS) {
+        throw allocator_t::allocation_exception_t{result, "Failed to allocate a memory block."};
+    }
+
+    if (p_host_visible) {
+        // Mapping memory isn't free, and you can't map the same memory object twice, so
+        // we just map the whole thing once and leave it mapped.
+        void* data;
+        result = vkMapMemory(m_device, m_memory, 0, VK_WHOLE_SIZE, 0, &data);
+        if (result != VK_SUCCESS) {
+            vkFreeMemory(m_device, m_memory, nullptr);
+            throw allocator_t::allocation_exception_t{result, "Failed to map a memory block."};
+        }
+
+        m_mapped_data = static_cast<std::byte*>(data);
+    }
+
+    if (m_strategy == allocation_strategy_t::free_list) {
+        m_free_ranges.emplace(0, p_size);
+    }
+}
+
+auto memory_block_t::try_allocate(VkDeviceSize p_size, VkDeviceSize p_alignment) -> std::optional<VkDeviceSize> {
+    if (m_strategy == allocation_strategy_t::linear) {
+        const auto offset = align_up(m_head, p_alignment);
+        if (offset + p_size > m_size) {
+            return std::optional<VkDeviceSize>{};
+        }
+
+        m_head = offset + p_size;
+        m_used += p_size;
+        m_allocation_count++;
+        return offset;
+    }
+
+    // First fit. There are rarely more than a handful of free ranges, so anything smarter
+    // than that isn't really worth it.
+    for (auto range = m_free_ranges.begin(); range != m_free_ranges.end(); range++) {
+        const auto [range_offset, range_size] = *range;
+        const auto offset = align_up(range_offset, p_alignment);
+
+        if (offset + p_size > range_offset + range_size) {
+            continue;
+        }
+
+        m_free_ranges.erase(range);
+
+        // Whatever is left over on either side of the allocation goes back into the free list,
+        // so that the padding from the alignment doesn't get lost.
+        if (offset > range_offset) {
+            m_free_ranges.emplace(range_offset, offset - range_offset);
+        }
+
+        if (offset + p_size < range_offset + range_size) {
+            m_free_ranges.emplace(offset + p_size, range_offset + range_size - (offset + p_size));
+        }
+
+        m_used += p_size;
+        m_allocation_count++;
+        return offset;
+    }
+
+    return std::optional<VkDeviceSize>{};
+}
+
+auto memory_block_t::free(VkDeviceSize p_offset, VkDeviceSize p_size) -> void {
+    m_used -= p_size;
+    m_allocation_count--;
+
+    if (m_strategy == allocation_strategy_t::linear) {
+        // A linear block can only be reused as a whole.
+        if (m_allocation_count == 0) {
+            m_head = 0;
+        }
+
+        return;
+    }
+
+    auto [range, inserted] = m_free_ranges.emplace(p_offset, p_size);
+
+    // Merge with the following range if the two touch.
+    const auto next = std::next(range);
+    if (next != m_free_ranges.end() && range->first + range->second == next->first) {
+        range->second += next->second;
+        m_free_ranges.erase(next);
+    }
+
+    // And the same with the previous one.
+    if (range != m_free_ranges.begin()) {
+        const auto previous = std::prev(range);
+        if (previous->first + previous->second == range->first) {
+            previous->second += range->second;
+            m_free_ranges.erase(range);
+        }
+    }
+}
+
+memory_block_t::~memory_block_t() noexcept {
+    // Freeing memory implicitly unmaps it.
+    vkFreeMemory(m_device, m_memory, nullptr);
+}
+
+allocator_t::allocator_t(const physical_device_t& p_physical_device, const device_t& p_device, VkDeviceSize p_block_size) :
+    m_physical_device(p_physical_device),
+    m_device(p_device),
+    m_block_size(p_block_size),
+    m_peak_block_count(0),
+    m_total_allocation_count(0)
+{
+    vkGetPhysicalDeviceMemoryProperties(m_physical_device, &m_memory_properties);
+
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceProperties(m_physical_device, &device_properties);
+    m_max_allocation_count = device_properties.limits.maxMemoryAllocationCount;
+}
+
+auto allocator_t::create_block(uint32_t p_memory_type, VkDeviceSize p_minimum_size, resource_kind_t p_kind, allocation_strategy_t p_strategy, bool p_dedicated) -> memory_block_t& {
+    if (m_blocks.size() >= m_max_allocation_count) {
+        throw allocation_exception_t{VK_ERROR_TOO_MANY_OBJECTS, "Ran out of memory allocations."};
+    }
+
+    const auto& memory_type = m_memory_properties.memoryTypes[p_memory_type];
+    const auto heap_size = m_memory_properties.memoryHeaps[memory_type.heapIndex].size;
+    const bool host_visible = memory_type.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+
+    // Don't hog more than an eighth of a small heap (such as the 256 MiB one that a lot
+    // of cards have for memory that is both device local and host visible).
+    auto block_size = p_dedicated ? p_minimum_size : std::max(std::min(m_block_size, heap_size / 8), p_minimum_size);
+
+    while (true) {
+        try {
+            auto& block = m_blocks.emplace_back(std::make_unique<memory_block_t>(
+                m_device, p_memory_type, block_size, host_visible, p_kind, p_strategy, p_dedicated
+            ));
+
+            m_peak_block_count = std::max(m_peak_block_count, static_cast<uint32_t>(m_blocks.size()));
+            return *block;
+        } catch (const allocation_exception_t& exception) {
+            // If the heap is getting full, then a smaller block might still fit.
+            const bool out_of_memory = exception.error_code == VK_ERROR_OUT_OF_DEVICE_MEMORY || exception.error_code == VK_ERROR_OUT_OF_HOST_MEMORY;
+            if (!out_of_memory || p_dedicated || block_size / 2 < p_minimum_size) {
+                throw;
+            }
+
+            block_size /= 2;
+        }
+    }
+}
+
+auto allocator_t::allocate(
+    const VkMemoryRequirements& p_requirements,
+    VkMemoryPropertyFlags p_properties,
+    resource_kind_t p_kind,
+    allocation_strategy_t p_strategy
+) -> allocation_t {
+    const auto memory_type = find_memory_type(m_physical_device, p_requirements.memoryTypeBits, p_properties);
+    if (!memory_type.has_value()) {
+        // We use VK_SUCCESS when Vulkan didn't return any error codes.
+        throw allocation_exception_t{VK_SUCCESS, "Could not find an adequate memory type."};
+    }
+
+    const std::lock_guard lock{m_mutex};
+
+    const auto make_allocation = [&](memory_block_t& p_block, VkDeviceSize p_offset) {
+        m_total_allocation_count++;
+
+        return allocation_t {
+            .block = &p_block,
+            .memory = p_block.get_memory(),
+            .offset = p_offset,
+            .size = p_requirements.size,
+            .mapped_data = p_block.get_mapped_data() != nullptr ? p_block.get_mapped_data() + p_offset : nullptr,
+        };
+    };
+
+    // Really big resources get a block all to themselves, otherwise they would just end up
+    // wasting most of a shared one.
+    if (p_requirements.size > m_block_size / 2) {
+        auto& block = create_block(memory_type.value(), p_requirements.size, p_kind, p_strategy, true);
+        return make_allocation(block, block.try_allocate(p_requirements.size, p_requirements.alignment).value());
+    }
+
+    for (auto& block : m_blocks) {
+        if (!block->is_compatible(memory_type.value(), p_kind, p_strategy)) {
+            continue;
+        }
+
+        const auto offset = block->try_allocate(p_requirements.size, p_requirements.alignment);
+        if (offset.has_value()) {
+            return make_allocation(*block, offset.value());
+        }
+    }
+
+    auto& block = create_block(memory_type.value(), p_requirements.size, p_kind, p_strategy, false);
+    return make_allocation(block, block.try_allocate(p_requirements.size, p_requirements.alignment).value());
+}
+
+auto allocator_t::free(const allocation_t& p_allocation) -> void {
+    if (p_allocation.block == nullptr) {
+        return;
+    }
+
+    const std::lock_guard lock{m_mutex};
+
+    p_allocation.block->free(p_allocation.offset, p_allocation.size);
+
+    if (!p_allocation.block->is_empty()) {
+        return;
+    }
+
+    // Dedicated blocks go straight back to the driver once they are empty. Shared ones are
+    // kept around, since we'd probably just have to allocate them again soon anyway.
+    if (!p_allocation.block->is_dedicated()) {
+        return;
+    }
+
+    const auto block = std::find_if(m_blocks.begin(), m_blocks.end(), [&](const auto& p_block) {
+        return p_block.get() == p_allocation.block;
+    });
+
+    if (block != m_blocks.end()) {
+        m_blocks.erase(block);
+    }
+}
+
+auto allocator_t::get_statistics() const -> statistics_t {
+    const std::lock_guard lock{m_mutex};
+
+    statistics_t statistics {
+        .block_count = static_cast<uint32_t>(m_blocks.size()),
+        .peak_block_count = m_peak_block_count,
+        .allocation_count = 0,
+        .total_allocation_count = m_total_allocation_count,
+        .reserved_bytes = 0,
+        .used_bytes = 0,
+    };
+
+    for (const auto& block : m_blocks) {
+        statistics.allocation_count += block->get_allocation_count();
+        statistics.reserved_bytes += block->get_size();
+        statistics.used_bytes += block->get_used();
+    }
+
+    return statistics;
+}
+
+auto allocator_t::print_statistics() const -> void {
+    const auto statistics = get_statistics();
+    constexpr double mebibyte = 1024.0 * 1024.0;
+
+    fmt::print(
+        stderr,
+        "[INFO]: Memory: {} live allocation(s) ({} in total) in {} block(s) (peak {}, limit {}), {:.2f} MiB used of {:.2f} MiB reserved.\n",
+        statistics.allocation_count,
+        statistics.total_allocation_count,
+        statistics.block_count,
+        statistics.peak_block_count,
+        m_max_allocation_count,
+        static_cast<double>(statistics.used_bytes) / mebibyte,
+        static_cast<double>(statistics.reserved_bytes) / mebibyte
+    );
+}
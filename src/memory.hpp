@@ -0,0 +1,162 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "common.hpp"
+#include "devices.hpp"
+
+namespace pooper_cube {
+    class memory_block_t;
+
+    // A range of device memory that was handed out by the allocator. Resources bind
+    // themselves to `memory` at `offset`.
+    struct allocation_t {
+        memory_block_t* block;
+        VkDeviceMemory memory;
+        VkDeviceSize offset;
+        VkDeviceSize size;
+
+        // Null unless the memory is host visible, in which case the whole block is
+        // kept mapped for as long as it lives.
+        void* mapped_data;
+    };
+
+    // Buffers and optimally tiled images are kept in separate blocks, so that we never
+    // have to worry about bufferImageGranularity.
+    enum class resource_kind_t {
+        buffer, image
+    };
+
+    enum class allocation_strategy_t {
+        // General purpose. Freed ranges are returned to a free list and can be reused
+        // right away.
+        free_list,
+
+        // For short lived allocations, such as staging buffers. Allocating is just a
+        // pointer bump, and the whole block is reused once everything in it has been freed.
+        linear,
+    };
+
+    // One VkDeviceMemory object, which gets split up between many resources.
+    class memory_block_t {
+        public:
+            memory_block_t(
+                const device_t& device,
+                uint32_t memory_type,
+                VkDeviceSize size,
+                bool host_visible,
+                resource_kind_t kind,
+                allocation_strategy_t strategy,
+                bool dedicated
+            );
+
+            NO_COPY(memory_block_t);
+
+            // Returns the offset of the new allocation, if there is enough room for it.
+            auto try_allocate(VkDeviceSize size, VkDeviceSize alignment) -> std::optional<VkDeviceSize>;
+
+            auto free(VkDeviceSize offset, VkDeviceSize size) -> void;
+
+            auto is_compatible(uint32_t memory_type, resource_kind_t kind, allocation_strategy_t strategy) const noexcept -> bool {
+                return !m_dedicated && m_memory_type == memory_type && m_kind == kind && m_strategy == strategy;
+            }
+
+            auto is_dedicated() const noexcept -> bool { return m_dedicated; }
+
+            auto is_empty() const noexcept -> bool { return m_allocation_count == 0; }
+
+            auto get_memory() const noexcept -> VkDeviceMemory { return m_memory; }
+
+            auto get_mapped_data() const noexcept -> std::byte* { return m_mapped_data; }
+
+            auto get_size() const noexcept -> VkDeviceSize { return m_size; }
+
+            auto get_used() const noexcept -> VkDeviceSize { return m_used; }
+
+            auto get_allocation_count() const noexcept -> uint32_t { return m_allocation_count; }
+
+            ~memory_block_t() noexcept;
+
+        private:
+            const device_t& m_device;
+
+            VkDeviceMemory m_memory;
+            std::byte* m_mapped_data;
+            VkDeviceSize m_size;
+
+            uint32_t m_memory_type;
+            resource_kind_t m_kind;
+            allocation_strategy_t m_strategy;
+            bool m_dedicated;
+
+            // Maps the offset of each free range to its size. Only used by free list blocks.
+            std::map<VkDeviceSize, VkDeviceSize> m_free_ranges;
+
+            // Only used by linear blocks.
+            VkDeviceSize m_head;
+
+            VkDeviceSize m_used;
+            uint32_t m_allocation_count;
+    };
+
+    // Hands out memory for buffers and images from a small number of large blocks,
+    // instead of calling vkAllocateMemory for every single resource. Thread safe.
+    class allocator_t {
+        public:
+            struct statistics_t {
+                uint32_t block_count;
+                uint32_t peak_block_count;
+                uint32_t allocation_count;
+                uint64_t total_allocation_count;
+                VkDeviceSize reserved_bytes;
+                VkDeviceSize used_bytes;
+            };
+
+            struct allocation_exception_t {
+                VkResult error_code;
+                std::string_view what;
+            };
+
+            allocator_t(const physical_device_t& physical_device, const device_t& device, VkDeviceSize block_size = default_block_size);
+            NO_COPY(allocator_t);
+
+            auto allocate(
+                const VkMemoryRequirements& requirements,
+                VkMemoryPropertyFlags properties,
+                resource_kind_t kind,
+                allocation_strategy_t strategy = allocation_strategy_t::free_list
+            ) -> allocation_t;
+
+            auto free(const allocation_t& allocation) -> void;
+
+            auto get_statistics() const -> statistics_t;
+
+            auto print_statistics() const -> void;
+
+            auto get_physical_device() const noexcept -> const physical_device_t& { return m_physical_device; }
+
+            auto get_device() const noexcept -> const device_t& { return m_device; }
+
+            static constexpr VkDeviceSize default_block_size = 64 * 1024 * 1024;
+
+        private:
+            auto create_block(uint32_t memory_type, VkDeviceSize minimum_size, resource_kind_t kind, allocation_strategy_t strategy, bool dedicated) -> memory_block_t&;
+
+            const physical_device_t& m_physical_device;
+            const device_t& m_device;
+
+            VkPhysicalDeviceMemoryProperties m_memory_properties;
+            uint32_t m_max_allocation_count;
+            VkDeviceSize m_block_size;
+
+            mutable std::mutex m_mutex;
+            std::vector<std::unique_ptr<memory_block_t>> m_blocks;
+
+            uint32_t m_peak_block_count;
+            uint64_t m_total_allocation_count;
+    };
+
+    auto find_memory_type(const physical_device_t& p_physical_device, uint32_t p_type_filter, VkMemoryPropertyFlags properties) -> std::optional<uint32_t>;
+}
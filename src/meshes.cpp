@@ -0,0 +1,148 @@
+#include "meshes.hpp"
+
+namespace {
+    using pooper_cube::vertex_t;
+
+    enum class cube_side_t {
+        front, back, top, bottom, left, right
+    };
+
+    auto append_cube_face(std::vector<vertex_t>& p_vertices, std::vector<uint32_t>& p_indices, float p_size, cube_side_t p_side) {
+        struct pairs_t {
+            float a;
+            float b;
+        };
+
+        const std::array<pairs_t, 4> pairs {
+            pairs_t {0.5f * p_size, -0.5f * p_size},
+            pairs_t {0.5f * p_size, 0.5f * p_size},
+            pairs_t {-0.5f * p_size, 0.5f * p_size},
+            pairs_t {-0.5f * p_size, -0.5f * p_size}
+        };
+
+        const auto index_base = static_cast<uint32_t>(p_vertices.size());
+
+        for (auto pair : pairs) {
+            switch (p_side) {
+                case cube_side_t::front:
+                    p_vertices.push_back(vertex_t {
+                        .position = {pair.a, pair.b, p_size * -0.5f}
+                    });
+                    break;
+                case cube_side_t::back:
+                    p_vertices.push_back(vertex_t {
+                        .position = {pair.a, pair.b, p_size * 0.5f}
+                    });
+                    break;
+                case cube_side_t::right:
+                    p_vertices.push_back(vertex_t {
+                        .position = {0.5f * p_size, pair.b, pair.a}
+                    });
+                    break;
+                case cube_side_t::left:
+                    p_vertices.push_back(vertex_t {
+                        .position = {-0.5f * p_size, pair.b, -pair.a}
+                    });
+                    break;
+                case cube_side_t::top:
+                    p_vertices.push_back(vertex_t {
+                        .position = {pair.a, -0.5f * p_size, pair.b}
+                    });
+                    break;
+                case cube_side_t::bottom:
+                    p_vertices.push_back(vertex_t {
+                        .position = {pair.a, 0.5f * p_size, pair.b}
+                    });
+                    break;
+            }
+        }
+
+        p_indices.insert(p_indices.end(), {
+            index_base + 0,
+            index_base + 1,
+            index_base + 2,
+            index_base + 0,
+            index_base + 2,
+            index_base + 3,
+       });
+    }
+}
+
+auto pooper_cube::generate_cube(float p_size) -> mesh_t {
+    mesh_t mesh;
+
+    const std::array<cube_side_t, 6> cube_sides {
+        cube_side_t::front,
+        cube_side_t::back,
+        cube_side_t::right,
+        cube_side_t::left,
+        cube_side_t::top,
+        cube_side_t::bottom,
+    };
+
+    for (auto side : cube_sides) {
+        append_cube_face(mesh.vertices, mesh.indices, p_size, side);
+    }
+
+    return mesh;
+}
+
+auto pooper_cube::generate_cube_grid(uint32_t p_count, job_system_t& p_jobs) -> std::vector<instance_data_t> {
+    std::vector<instance_data_t> instances(p_count);
+
+    // The smallest grid that has room for all of the cubes. The last layer might not end
+    // up being full.
+    uint32_t side = 1;
+    while (static_cast<uint64_t>(side) * side * side < p_count) {
+        side++;
+    }
+
+    const float cell_size = 2.0f / static_cast<float>(side);
+
+    // Every cube only depends on its own index, so each job just fills in a range of them.
+    p_jobs.parallel_for(p_count, [&](size_t p_begin, size_t p_end) {
+        for (auto i = static_cast<uint32_t>(p_begin); i < p_end; i++) {
+            const glm::vec3 coordinate {
+                static_cast<float>(i % side),
+                static_cast<float>((i / side) % side),
+                static_cast<float>(i / (side * side)),
+            };
+
+            const auto position = (coordinate + 0.5f) * cell_size - 1.0f;
+            auto model = glm::translate(glm::mat4{1.0f}, position);
+            model = glm::scale(model, glm::vec3{cell_size * 0.5f});
+
+            // Fade from grey in one corner to white in the opposite one, so that the cubes
+            // can be told apart.
+            const auto normalized = side > 1 ? coordinate / static_cast<float>(side - 1) : glm::vec3{1.0f};
+
+            instances[i] = instance_data_t {
+                .model = model,
+                .color = glm::vec4{glm::mix(glm::vec3{0.4f}, glm::vec3{1.0f}, normalized), 1.0f},
+            };
+        }
+    });
+
+    return instances;
+}
+
+auto pooper_cube::generate_nested_cubes(uint32_t p_count, job_system_t& p_jobs) -> std::vector<instance_data_t> {
+    std::vector<instance_data_t> instances(p_count);
+
+    constexpr float smallest_size = 0.5f;
+    constexpr float largest_size = 2.5f;
+
+    p_jobs.parallel_for(p_count, [&](size_t p_begin, size_t p_end) {
+        for (auto i = static_cast<uint32_t>(p_begin); i < p_end; i++) {
+            const auto progress = static_cast<float>(i + 1) / static_cast<float>(p_count);
+            const auto model = glm::scale(glm::mat4{1.0f}, glm::vec3{smallest_size + (largest_size - smallest_size) * progress});
+
+            instances[i] = instance_data_t {
+                .model = model,
+                .color = glm::vec4{glm::mix(glm::vec3{0.4f}, glm::vec3{1.0f}, glm::vec3{progress}), 1.0f},
+            };
+        }
+    });
+
+    return instances;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "common.hpp"
+#include "buffers.hpp"
+#include "jobs.hpp"
+
+namespace pooper_cube {
+    struct mesh_t {
+        std::vector<vertex_t> vertices;
+        std::vector<uint32_t> indices;
+    };
+
+    // Generates a cube centered on the origin, with each side being p_size long.
+    auto generate_cube(float p_size) -> mesh_t;
+
+    // Lays out p_count unit cubes in a grid from -1 to 1 on every axis, scaled down so that
+    // they leave a gap between each other. A single cube comes out exactly as it would
+    // without instancing. The cubes are spread over the job system, since there can be
+    // millions of them.
+    auto generate_cube_grid(uint32_t p_count, job_system_t& p_jobs) -> std::vector<instance_data_t>;
+
+    // Puts p_count cubes inside of each other, from the smallest to the largest. Since every
+    // cube completely surrounds the ones before it, each of them passes the depth test no
+    // matter how the scene is turned, which makes for as much overdraw as possible.
+    auto generate_nested_cubes(uint32_t p_count, job_system_t& p_jobs) -> std::vector<instance_data_t>;
+}
@@ -0,0 +1,131 @@
+#include <fstream>
+
+#include "pipeline-cache.hpp"
+
+using pooper_cube::pipeline_cache_t;
+
+namespace {
+    auto read_file(const std::filesystem::path& p_path) -> std::vector<char> {
+        std::ifstream file{p_path, std::ios::ate | std::ios::binary};
+        if (!file) {
+            return std::vector<char>{};
+        }
+
+        const size_t file_size = file.tellg();
+        std::vector<char> buffer(file_size);
+        file.seekg(0).read(buffer.data(), file_size);
+
+        if (!file) {
+            return std::vector<char>{};
+        }
+
+        return buffer;
+    }
+}
+
+pipeline_cache_t::pipeline_cache_t(const physical_device_t& p_physical_device, const device_t& p_device, std::optional<std::filesystem::path> p_path) :
+    m_device(p_device),
+    m_path(std::move(p_path)),
+    m_was_loaded(false)
+{
+    vkGetPhysicalDeviceProperties(p_physical_device, &m_device_properties);
+
+    std::vector<char> initial_data;
+    if (m_path.has_value()) {
+        initial_data = read_file(m_path.value());
+
+        if (!initial_data.empty() && !is_compatible(initial_data)) {
+            fmt::print(stderr, "[INFO]: Ignoring the pipeline cache at {}, since it was made for a different device or driver.\n", m_path->string());
+            initial_data.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo cache_info {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .initialDataSize = initial_data.size(),
+        .pInitialData = initial_data.data(),
+    };
+
+    auto result = vkCreatePipelineCache(m_device, &cache_info, nullptr, &m_cache);
+    if (result != VK_SUCCESS && !initial_data.empty()) {
+        // Maybe the driver didn't like the data after all. Starting cold is better than
+        // not starting at all.
+        cache_info.initialDataSize = 0;
+        cache_info.pInitialData = nullptr;
+        initial_data.clear();
+
+        result = vkCreatePipelineCache(m_device, &cache_info, nullptr, &m_cache);
+    }
+
+    if (result != VK_SUCCESS) {
+        throw vulkan_creation_exception_t{result, "pipeline cache"};
+    }
+
+    m_was_loaded = !initial_data.empty();
+}
+
+auto pipeline_cache_t::is_compatible(std::span<const char> p_data) const noexcept -> bool {
+    VkPipelineCacheHeaderVersionOne header;
+    if (p_data.size() < sizeof(header)) {
+        return false;
+    }
+
+    std::memcpy(&header, p_data.data(), sizeof(header));
+
+    return header.headerSize >= sizeof(header) &&
+        header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+        header.vendorID == m_device_properties.vendorID &&
+        header.deviceID == m_device_properties.deviceID &&
+        std::memcmp(header.pipelineCacheUUID, m_device_properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+auto pipeline_cache_t::save() const -> void {
+    if (!m_path.has_value()) {
+        return;
+    }
+
+    size_t data_size;
+    auto result = vkGetPipelineCacheData(m_device, m_cache, &data_size, nullptr);
+    if (result != VK_SUCCESS) {
+        throw generic_vulkan_exception_t{result, "Failed to get the size of the pipeline cache data."};
+    }
+
+    std::vector<char> data(data_size);
+    result = vkGetPipelineCacheData(m_device, m_cache, &data_size, data.data());
+    if (result != VK_SUCCESS && result != VK_INCOMPLETE) {
+        throw generic_vulkan_exception_t{result, "Failed to get the pipeline cache data."};
+    }
+
+    auto temporary_path = m_path.value();
+    temporary_path += ".tmp";
+
+    {
+        std::ofstream file{temporary_path, std::ios::binary | std::ios::trunc};
+        if (!file) {
+            throw file_opening_exception_t{"pipeline cache"};
+        }
+
+        file.write(data.data(), static_cast<std::streamsize>(data_size));
+        file.flush();
+
+        if (!file) {
+            throw file_opening_exception_t{"pipeline cache"};
+        }
+    }
+
+    // Renaming is atomic, so anyone reading the cache sees either the old one or the new
+    // one in full.
+    std::filesystem::rename(temporary_path, m_path.value());
+}
+
+pipeline_cache_t::~pipeline_cache_t() noexcept {
+    try {
+        save();
+    } catch (...) {
+        fmt::print(stderr, fmt::fg(fmt::color::yellow), "[WARNING]: Failed to save the pipeline cache.\n");
+    }
+
+    vkDestroyPipelineCache(m_device, m_cache, nullptr);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <filesystem>
+
+#include "common.hpp"
+#include "devices.hpp"
+
+namespace pooper_cube {
+    // A VkPipelineCache that is loaded from a file when it's created, and written back to
+    // that file when it's destroyed, so that pipelines don't have to be compiled from
+    // scratch on every launch.
+    class pipeline_cache_t {
+        public:
+            // Without a path, the cache only lives for as long as the program does.
+            pipeline_cache_t(const physical_device_t& physical_device, const device_t& device, std::optional<std::filesystem::path> path);
+            NO_COPY(pipeline_cache_t);
+
+            operator VkPipelineCache() const noexcept { return m_cache; }
+
+            // Whether usable data was found in the file, i.e. whether this is a warm start.
+            auto was_loaded() const noexcept -> bool { return m_was_loaded; }
+
+            // Writes the cache to a temporary file first and then renames it over the real
+            // one, so that a crash halfway through can never leave a broken cache behind.
+            auto save() const -> void;
+
+            ~pipeline_cache_t() noexcept;
+
+        private:
+            // Checks that the data was produced by the same device and driver that we are
+            // running on. Drivers are supposed to reject mismatching data themselves, but
+            // not all of them are good at it.
+            auto is_compatible(std::span<const char> data) const noexcept -> bool;
+
+            const device_t& m_device;
+
+            VkPipelineCache m_cache;
+            VkPhysicalDeviceProperties m_device_properties;
+
+            std::optional<std::filesystem::path> m_path;
+            bool m_was_loaded;
+    };
+}
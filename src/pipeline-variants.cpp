@@ -0,0 +1,42 @@
+#include "pipeline-variants.hpp"
+
+using pooper_cube::pipeline_variants_t;
+
+pipeline_variants_t::pipeline_variants_t(
+    const device_t& p_device,
+    std::unique_ptr<shader_module_t> p_vertex_shader,
+    std::unique_ptr<shader_module_t> p_fragment_shader,
+    const pipeline_layout_t& p_layout,
+    const pipeline_target_t& p_target,
+    const pipeline_cache_t& p_cache
+) :
+    m_device(p_device),
+    m_vertex_shader(std::move(p_vertex_shader)),
+    m_fragment_shader(std::move(p_fragment_shader)),
+    m_layout(p_layout),
+    m_target(p_target),
+    m_cache(p_cache)
+{}
+
+auto pipeline_variants_t::get(const graphics_pipeline_state_t& p_state) -> VkPipeline {
+    auto pipeline = m_pipelines.find(p_state);
+    if (pipeline != m_pipelines.end()) {
+        return *pipeline->second;
+    }
+
+    // Only inserted once it has been built, so that a state that fails to build isn't
+    // left behind as a null entry.
+    auto built = std::make_unique<graphics_pipeline_t>(m_device, *m_vertex_shader, *m_fragment_shader, m_layout, m_target, m_cache, p_state);
+    return *m_pipelines.emplace(p_state, std::move(built)).first->second;
+}
+
+auto pipeline_variants_t::get_states() const -> std::vector<graphics_pipeline_state_t> {
+    std::vector<graphics_pipeline_state_t> states;
+    states.reserve(m_pipelines.size());
+
+    for (const auto& [state, pipeline] : m_pipelines) {
+        states.push_back(state);
+    }
+
+    return states;
+}
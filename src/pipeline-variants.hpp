@@ -0,0 +1,53 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+
+#include "common.hpp"
+#include "devices.hpp"
+#include "pipeline-cache.hpp"
+#include "pipelines.hpp"
+
+namespace pooper_cube {
+    // Every graphics pipeline that has been built out of one pair of shaders for one target,
+    // keyed by the state it was built with. Asking for the same state twice hands out the
+    // same VkPipeline, so each distinct state only ever gets compiled once.
+    //
+    // Owns the shaders, since new variants can be asked for at any time.
+    class pipeline_variants_t {
+        public:
+            pipeline_variants_t(
+                const device_t& device,
+                std::unique_ptr<shader_module_t> vertex_shader,
+                std::unique_ptr<shader_module_t> fragment_shader,
+                const pipeline_layout_t& layout,
+                const pipeline_target_t& target,
+                const pipeline_cache_t& cache
+            );
+
+            NO_COPY(pipeline_variants_t);
+
+            // Builds the pipeline if this is the first time that the state has been asked
+            // for. Not thread safe, so the recording threads should be handed the
+            // VkPipeline instead of looking it up themselves.
+            auto get(const graphics_pipeline_state_t& state) -> VkPipeline;
+
+            // Every state that has been built so far, for building the same variants out of
+            // a different set of shaders.
+            auto get_states() const -> std::vector<graphics_pipeline_state_t>;
+
+            auto get_count() const noexcept -> size_t { return m_pipelines.size(); }
+
+        private:
+            const device_t& m_device;
+
+            std::unique_ptr<shader_module_t> m_vertex_shader;
+            std::unique_ptr<shader_module_t> m_fragment_shader;
+
+            const pipeline_layout_t& m_layout;
+            pipeline_target_t m_target;
+            const pipeline_cache_t& m_cache;
+
+            std::unordered_map<graphics_pipeline_state_t, std::unique_ptr<graphics_pipeline_t>, graphics_pipeline_state_hash_t> m_pipelines;
+    };
+}
@@ -7,32 +7,67 @@
 
 using pooper_cube::shader_module_t;
 using pooper_cube::graphics_pipeline_t;
+using pooper_cube::compute_pipeline_t;
 using pooper_cube::pipeline_layout_t;
+using pooper_cube::blend_mode_t;
+using pooper_cube::graphics_pipeline_state_t;
+using pooper_cube::graphics_pipeline_state_hash_t;
+
+namespace {
+    // The usual boost-style mix, good enough for a handful of small enums.
+    auto hash_combine(size_t p_seed, size_t p_value) noexcept -> size_t {
+        return p_seed ^ (p_value + 0x9e3779b97f4a7c15ull + (p_seed << 6) + (p_seed >> 2));
+    }
+}
 
-shader_module_t::shader_module_t(const device_t& p_device, type_t p_type, std::string_view p_code_path) : m_device(p_device) {
+auto shader_module_t::read_code(std::string_view p_code_path) -> std::vector<uint32_t> {
     std::ifstream file{p_code_path.data(), std::ios::ate | std::ios::binary};
     if (!file) {
         throw file_opening_exception_t{p_code_path};
     }
 
     const size_t file_size = file.tellg();
-    std::vector<char> buffer(file_size);
-    file.seekg(0).read(buffer.data(), file_size);
 
-    file.close();
+    // SPIR-V is made out of 32-bit words, so anything else is either not SPIR-V at all, or
+    // a file that is still being written.
+    if (file_size % sizeof(uint32_t) != 0) {
+        throw vulkan_creation_exception_t{VK_ERROR_INITIALIZATION_FAILED, "shader module"};
+    }
+
+    std::vector<uint32_t> code(file_size / sizeof(uint32_t));
+    file.seekg(0).read(reinterpret_cast<char*>(code.data()), static_cast<std::streamsize>(file_size));
+
+    return code;
+}
+
+shader_module_t::shader_module_t(const device_t& p_device, type_t p_type, std::string_view p_code_path) :
+    shader_module_t(p_device, p_type, read_code(p_code_path))
+{}
+
+shader_module_t::shader_module_t(const device_t& p_device, type_t p_type, std::span<const uint32_t> p_code) : m_device(p_device) {
+    // Checking for the magic number at least stops garbage from getting anywhere near the
+    // driver, which isn't required to cope with it.
+    constexpr uint32_t spirv_magic_number = 0x07230203;
+
+    if (p_code.empty() || p_code.front() != spirv_magic_number) {
+        throw vulkan_creation_exception_t{VK_ERROR_INITIALIZATION_FAILED, "shader module"};
+    }
 
     const VkShaderModuleCreateInfo module_info {
         .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
         .pNext = nullptr,
         .flags = 0,
-        .codeSize = file_size,
-        .pCode = reinterpret_cast<const uint32_t*>(buffer.data()),
+        .codeSize = p_code.size_bytes(),
+        .pCode = p_code.data(),
     };
 
     switch (p_type) {
         case type_t::vertex:
             m_type = VK_SHADER_STAGE_VERTEX_BIT;
             break;
+        case type_t::compute:
+            m_type = VK_SHADER_STAGE_COMPUTE_BIT;
+            break;
         case type_t::fragment:
             m_type = VK_SHADER_STAGE_FRAGMENT_BIT;
             break;
@@ -66,7 +101,12 @@ pipeline_layout_t::pipeline_layout_t(
 }
 
 namespace pooper_cube {
-    render_pass_t::render_pass_t(const device_t& p_device, VkFormat p_format, VkFormat p_depth_format): m_device(p_device) {
+    render_pass_t::render_pass_t(
+        const device_t& p_device, 
+        VkFormat p_format, 
+        VkFormat p_depth_format, 
+        VkImageLayout p_final_layout
+    ): m_device(p_device) {
         const VkAttachmentDescription color_attachment {
             .flags = 0,
             .format = p_format,
@@ -74,7 +114,7 @@ namespace pooper_cube {
             .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
             .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
             .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-            .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+            .finalLayout = p_final_layout,
         };
 
         const VkAttachmentDescription depth_attachment {
@@ -114,6 +154,20 @@ namespace pooper_cube {
             .pPreserveAttachments = nullptr,
         };
 
+        // With several frames in flight, the depth buffer is shared between render passes
+        // that may overlap on the GPU, so each one has to wait for the attachment writes
+        // of the one before it. This also makes the layout transition of the color
+        // attachment wait for the image to actually be acquired.
+        const VkSubpassDependency dependency {
+            .srcSubpass = VK_SUBPASS_EXTERNAL,
+            .dstSubpass = 0,
+            .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+            .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .dependencyFlags = 0,
+        };
+
         const VkRenderPassCreateInfo render_pass_info {
             .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
             .pNext = nullptr,
@@ -122,8 +176,8 @@ namespace pooper_cube {
             .pAttachments = attachments.data(),
             .subpassCount = 1,
             .pSubpasses = &subpass,
-            .dependencyCount = 0,
-            .pDependencies = nullptr,
+            .dependencyCount = 1,
+            .pDependencies = &dependency,
         };
 
         const auto result = vkCreateRenderPass(m_device, &render_pass_info, nullptr, &m_render_pass);
@@ -133,31 +187,72 @@ namespace pooper_cube {
     }
 }
 
+auto graphics_pipeline_state_hash_t::operator()(const graphics_pipeline_state_t& p_state) const noexcept -> size_t {
+    size_t hash = 0;
+
+    hash = hash_combine(hash, static_cast<size_t>(p_state.topology));
+    hash = hash_combine(hash, static_cast<size_t>(p_state.polygon_mode));
+    hash = hash_combine(hash, static_cast<size_t>(p_state.cull_mode));
+    hash = hash_combine(hash, static_cast<size_t>(p_state.front_face));
+    hash = hash_combine(hash, static_cast<size_t>(p_state.depth_test));
+    hash = hash_combine(hash, static_cast<size_t>(p_state.depth_write));
+    hash = hash_combine(hash, static_cast<size_t>(p_state.depth_compare_op));
+    hash = hash_combine(hash, static_cast<size_t>(p_state.blend_mode));
+    hash = hash_combine(hash, p_state.specialization_constant_count);
+
+    for (const auto constant : p_state.specialization_constants) {
+        hash = hash_combine(hash, constant);
+    }
+
+    return hash;
+}
+
 graphics_pipeline_t::graphics_pipeline_t(
         const device_t& p_device, 
         const shader_module_t& p_vertex_module, 
         const shader_module_t& p_fragment_module,
         const pipeline_layout_t& p_layout,
-        const render_pass_t& p_render_pass
+        const pipeline_target_t& p_target,
+        const pipeline_cache_t& p_cache,
+        const graphics_pipeline_state_t& p_state
 ) : m_device(p_device) {
-    const std::array<VkPipelineShaderStageCreateInfo, 2> shader_stages {
+    // Every constant is a single 32-bit word, and constant i lives at word i.
+    std::array<VkSpecializationMapEntry, graphics_pipeline_state_t::max_specialization_constants> specialization_entries;
+    for (uint32_t i = 0; i < specialization_entries.size(); i++) {
+        specialization_entries[i] = VkSpecializationMapEntry {
+            .constantID = i,
+            .offset = static_cast<uint32_t>(i * sizeof(uint32_t)),
+            .size = sizeof(uint32_t),
+        };
+    }
+
+    const VkSpecializationInfo specialization_info {
+        .mapEntryCount = p_state.specialization_constant_count,
+        .pMapEntries = specialization_entries.data(),
+        .dataSize = p_state.specialization_constant_count * sizeof(uint32_t),
+        .pData = p_state.specialization_constants.data(),
+    };
+
+    // Stages that don't declare a constant simply ignore it, so both can share the same
+    // specialization info.
+    std::array<VkPipelineShaderStageCreateInfo, 2> shader_stages {
         p_vertex_module.get_shader_stage(),
         p_fragment_module.get_shader_stage()
     };
 
-    const VkVertexInputBindingDescription vertex_binding_description {
-        .binding = 0,
-        .stride = sizeof(vertex_t),
-        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
-    };
+    if (p_state.specialization_constant_count > 0) {
+        for (auto& stage : shader_stages) {
+            stage.pSpecializationInfo = &specialization_info;
+        }
+    }
 
     const VkPipelineVertexInputStateCreateInfo vertex_input_state {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
         .pNext = nullptr,
         .flags = 0,
-        .vertexBindingDescriptionCount = 1,
-        .pVertexBindingDescriptions = &vertex_binding_description,
-        .vertexAttributeDescriptionCount = vertex_attribute_descriptions.size(),
+        .vertexBindingDescriptionCount = static_cast<uint32_t>(vertex_binding_descriptions.size()),
+        .pVertexBindingDescriptions = vertex_binding_descriptions.data(),
+        .vertexAttributeDescriptionCount = static_cast<uint32_t>(vertex_attribute_descriptions.size()),
         .pVertexAttributeDescriptions = vertex_attribute_descriptions.data(),
     };
 
@@ -165,7 +260,7 @@ graphics_pipeline_t::graphics_pipeline_t(
         .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
         .pNext = nullptr,
         .flags = 0,
-        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+        .topology = p_state.topology,
         .primitiveRestartEnable = VK_FALSE,
     };
 
@@ -186,9 +281,9 @@ graphics_pipeline_t::graphics_pipeline_t(
         .flags = 0,
         .depthClampEnable = VK_FALSE,
         .rasterizerDiscardEnable = VK_FALSE,
-        .polygonMode = VK_POLYGON_MODE_FILL,
-        .cullMode = VK_CULL_MODE_NONE,
-        .frontFace = VK_FRONT_FACE_CLOCKWISE,
+        .polygonMode = p_state.polygon_mode,
+        .cullMode = p_state.cull_mode,
+        .frontFace = p_state.front_face,
         .depthBiasEnable = VK_FALSE,
         .depthBiasConstantFactor = 0.0f,
         .depthBiasClamp = 0.0f,
@@ -212,9 +307,9 @@ graphics_pipeline_t::graphics_pipeline_t(
         .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
         .pNext = nullptr,
         .flags = 0,
-        .depthTestEnable = VK_TRUE,
-        .depthWriteEnable = VK_TRUE,
-        .depthCompareOp = VK_COMPARE_OP_LESS,
+        .depthTestEnable = p_state.depth_test ? VK_TRUE : VK_FALSE,
+        .depthWriteEnable = p_state.depth_write ? VK_TRUE : VK_FALSE,
+        .depthCompareOp = p_state.depth_compare_op,
         .depthBoundsTestEnable = VK_FALSE,
         .stencilTestEnable = VK_FALSE,
         .front = {},
@@ -223,13 +318,15 @@ graphics_pipeline_t::graphics_pipeline_t(
         .maxDepthBounds = 1.0f,
     };
 
+    const bool blend = p_state.blend_mode == blend_mode_t::alpha;
+
     const VkPipelineColorBlendAttachmentState color_blend_attachment {
-        .blendEnable = VK_FALSE,
-        .srcColorBlendFactor = VK_BLEND_FACTOR_ZERO,
-        .dstColorBlendFactor = VK_BLEND_FACTOR_ZERO,
+        .blendEnable = blend ? VK_TRUE : VK_FALSE,
+        .srcColorBlendFactor = blend ? VK_BLEND_FACTOR_SRC_ALPHA : VK_BLEND_FACTOR_ZERO,
+        .dstColorBlendFactor = blend ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ZERO,
         .colorBlendOp = VK_BLEND_OP_ADD,
-        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
-        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+        .srcAlphaBlendFactor = blend ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ZERO,
+        .dstAlphaBlendFactor = blend ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ZERO,
         .alphaBlendOp = VK_BLEND_OP_ADD,
         .colorWriteMask =
             VK_COLOR_COMPONENT_R_BIT |
@@ -264,9 +361,21 @@ graphics_pipeline_t::graphics_pipeline_t(
         .pDynamicStates = dynamic_states.data(),
     };
 
+    // Ignored when there is a render pass, since that already says what the attachments
+    // are.
+    const VkPipelineRenderingCreateInfo rendering_info {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+        .pNext = nullptr,
+        .viewMask = 0,
+        .colorAttachmentCount = 1,
+        .pColorAttachmentFormats = &p_target.color_format,
+        .depthAttachmentFormat = p_target.depth_format,
+        .stencilAttachmentFormat = VK_FORMAT_UNDEFINED,
+    };
+
     const VkGraphicsPipelineCreateInfo pipeline_info {
         .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-        .pNext = nullptr,
+        .pNext = p_target.render_pass == VK_NULL_HANDLE ? &rendering_info : nullptr,
         .flags = 0,
         .stageCount = shader_stages.size(),
         .pStages = shader_stages.data(),
@@ -280,14 +389,36 @@ graphics_pipeline_t::graphics_pipeline_t(
         .pColorBlendState = &color_blend_state,
         .pDynamicState = &dynamic_state,
         .layout = p_layout,
-        .renderPass = p_render_pass,
+        .renderPass = p_target.render_pass,
         .subpass = 0,
         .basePipelineHandle = VK_NULL_HANDLE,
         .basePipelineIndex = -1,
     };
 
-    const auto result = vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &m_pipeline);
+    const auto result = vkCreateGraphicsPipelines(m_device, p_cache, 1, &pipeline_info, nullptr, &m_pipeline);
     if (result != VK_SUCCESS) {
         throw vulkan_creation_exception_t{result, "graphics pipeline"};
     }
 }
+
+compute_pipeline_t::compute_pipeline_t(
+        const device_t& p_device,
+        const shader_module_t& p_compute_module,
+        const pipeline_layout_t& p_layout,
+        const pipeline_cache_t& p_cache
+) : m_device(p_device) {
+    const VkComputePipelineCreateInfo pipeline_info {
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .stage = p_compute_module.get_shader_stage(),
+        .layout = p_layout,
+        .basePipelineHandle = VK_NULL_HANDLE,
+        .basePipelineIndex = -1,
+    };
+
+    const auto result = vkCreateComputePipelines(m_device, p_cache, 1, &pipeline_info, nullptr, &m_pipeline);
+    if (result != VK_SUCCESS) {
+        throw vulkan_creation_exception_t{result, "compute pipeline"};
+    }
+}
@@ -2,16 +2,23 @@
 
 #include "common.hpp"
 #include "devices.hpp"
+#include "pipeline-cache.hpp"
 
 namespace pooper_cube {
     class shader_module_t {
         public:
             enum class type_t {
-                vertex, fragment
+                vertex, fragment, compute
             };
 
+            // Reads the SPIR-V from a file. Only used for reloading the shaders, everything
+            // else uses the SPIR-V that is built into the executable.
             explicit shader_module_t(const device_t& device, type_t type, std::string_view code_path);
 
+            explicit shader_module_t(const device_t& device, type_t type, std::span<const uint32_t> code);
+
+            NO_COPY(shader_module_t);
+
             auto get_shader_stage() const noexcept -> VkPipelineShaderStageCreateInfo {
                 return {
                     .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
@@ -32,6 +39,8 @@ namespace pooper_cube {
             }
             
         private:
+            static auto read_code(std::string_view code_path) -> std::vector<uint32_t>;
+
             const device_t& m_device;
 
             VkShaderModule m_module;
@@ -57,7 +66,14 @@ namespace pooper_cube {
 
     class render_pass_t {
         public:
-            render_pass_t(const device_t& device, VkFormat format, VkFormat depth_format);
+            // The final layout is what the color attachment is left in once the render
+            // pass is done. The default is for rendering onto swap chain images.
+            render_pass_t(
+                const device_t& device, 
+                VkFormat format, 
+                VkFormat depth_format, 
+                VkImageLayout final_layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+            );
             NO_COPY(render_pass_t);
 
             operator VkRenderPass() const noexcept { return m_render_pass; }
@@ -72,6 +88,67 @@ namespace pooper_cube {
             VkRenderPass m_render_pass;
     };
 
+    // What a graphics pipeline draws into. With dynamic rendering, there is no render pass,
+    // and the formats of the attachments are all that the pipeline gets to know about them.
+    struct pipeline_target_t {
+        // Null with dynamic rendering.
+        VkRenderPass render_pass;
+
+        VkFormat color_format;
+        VkFormat depth_format;
+    };
+
+    enum class blend_mode_t : uint8_t {
+        opaque,
+
+        // Regular non-premultiplied alpha blending.
+        alpha,
+    };
+
+    // Everything that can differ between two graphics pipelines that are built out of the
+    // same shaders, layout and render pass. Doubles as the key of the variant cache, so it
+    // should always be zero-initialized before being filled in, otherwise the unused
+    // specialization constants make two identical states look different.
+    struct graphics_pipeline_state_t {
+        static constexpr uint32_t max_specialization_constants = 4;
+
+        VkPrimitiveTopology topology;
+        VkPolygonMode polygon_mode;
+        VkCullModeFlags cull_mode;
+        VkFrontFace front_face;
+
+        bool depth_test;
+        bool depth_write;
+        VkCompareOp depth_compare_op;
+
+        blend_mode_t blend_mode;
+
+        // Constant i gets the constant_id i, in every stage. They're all 32 bits, which
+        // covers bools, integers and (through std::bit_cast) floats.
+        uint32_t specialization_constant_count;
+        std::array<uint32_t, max_specialization_constants> specialization_constants;
+
+        auto operator==(const graphics_pipeline_state_t&) const -> bool = default;
+    };
+
+    struct graphics_pipeline_state_hash_t {
+        auto operator()(const graphics_pipeline_state_t& state) const noexcept -> size_t;
+    };
+
+    // What the cubes have always been drawn with.
+    constexpr graphics_pipeline_state_t default_pipeline_state {
+        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+        .polygon_mode = VK_POLYGON_MODE_FILL,
+        .cull_mode = VK_CULL_MODE_NONE,
+        .front_face = VK_FRONT_FACE_CLOCKWISE,
+        .depth_test = true,
+        .depth_write = true,
+        .depth_compare_op = VK_COMPARE_OP_LESS,
+        .blend_mode = blend_mode_t::opaque,
+        .specialization_constant_count = 0,
+        .specialization_constants = {},
+    };
+
     class graphics_pipeline_t {
         public:
             graphics_pipeline_t(
@@ -79,7 +156,9 @@ namespace pooper_cube {
                     const shader_module_t& vertex_module, 
                     const shader_module_t& fragment_module, 
                     const pipeline_layout_t& layout,
-                    const render_pass_t& render_pass
+                    const pipeline_target_t& target,
+                    const pipeline_cache_t& cache,
+                    const graphics_pipeline_state_t& state = default_pipeline_state
             );
 
             NO_COPY(graphics_pipeline_t);
@@ -93,4 +172,25 @@ namespace pooper_cube {
             VkPipeline m_pipeline;
             const device_t& m_device;
     };
+
+    class compute_pipeline_t {
+        public:
+            compute_pipeline_t(
+                    const device_t& device,
+                    const shader_module_t& compute_module,
+                    const pipeline_layout_t& layout,
+                    const pipeline_cache_t& cache
+            );
+
+            NO_COPY(compute_pipeline_t);
+
+            operator VkPipeline() const noexcept { return m_pipeline; }
+
+            ~compute_pipeline_t() noexcept {
+                vkDestroyPipeline(m_device, m_pipeline, nullptr);
+            }
+        private:
+            VkPipeline m_pipeline;
+            const device_t& m_device;
+    };
 }
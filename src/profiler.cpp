@@ -0,0 +1,358 @@
+#include <numeric>
+
+#include "profiler.hpp"
+
+using pooper_cube::gpu_profiler_t;
+
+namespace {
+    // Enough for a few seconds worth of frames, which smooths things out without hiding
+    // changes for too long.
+    constexpr size_t series_length = 256;
+
+    // These come back from the query in the order of their bits.
+    constexpr std::array<std::string_view, 6> statistic_names {
+        "input assembly vertices",
+        "vertex shader invocations",
+        "clipping invocations",
+        "clipping primitives",
+        "fragment shader invocations",
+        "compute shader invocations",
+    };
+
+    constexpr VkQueryPipelineStatisticFlags statistic_flags =
+        VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+}
+
+auto gpu_profiler_t::series_t::add(double p_sample) -> void {
+    if (samples.size() < series_length) {
+        samples.push_back(p_sample);
+    } else {
+        samples[next_sample] = p_sample;
+    }
+
+    next_sample = (next_sample + 1) % series_length;
+}
+
+auto gpu_profiler_t::series_t::get_average() const noexcept -> double {
+    if (samples.empty()) {
+        return 0.0;
+    }
+
+    return std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size());
+}
+
+auto gpu_profiler_t::series_t::get_percentile(double p_percentile) const -> double {
+    if (samples.empty()) {
+        return 0.0;
+    }
+
+    auto sorted = samples;
+    const auto rank = static_cast<size_t>(p_percentile / 100.0 * static_cast<double>(sorted.size() - 1) + 0.5);
+
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    return sorted[rank];
+}
+
+gpu_profiler_t::gpu_profiler_t(
+    const physical_device_t& p_physical_device,
+    const device_t& p_device,
+    uint32_t p_frame_count,
+    std::optional<std::filesystem::path> p_csv_path,
+    bool p_keep_frame_times
+) :
+    m_device(p_device),
+    m_timestamp_pool(VK_NULL_HANDLE),
+    m_statistics_pool(VK_NULL_HANDLE),
+    m_statistics_flags(0),
+    m_timestamp_period(0.0),
+    m_timestamp_mask(0),
+    m_frames(p_frame_count, frame_queries_t{false, 0, {}, {}, false}),
+    m_current_frame(0),
+    m_frame_number(0),
+    m_keep_frame_times(p_keep_frame_times),
+    m_last_report(std::chrono::steady_clock::now())
+{
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceProperties(p_physical_device, &device_properties);
+
+    uint32_t queue_family_count;
+    vkGetPhysicalDeviceQueueFamilyProperties(p_physical_device, &queue_family_count, nullptr);
+
+    std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(p_physical_device, &queue_family_count, queue_families.data());
+
+    const auto valid_bits = queue_families[p_physical_device.graphics_queue_family].timestampValidBits;
+
+    if (valid_bits == 0) {
+        fmt::print(stderr, fmt::fg(fmt::color::yellow), "[WARNING]: The graphics queue doesn't support timestamps, so GPU times won't be measured.\n");
+    } else {
+        m_timestamp_period = device_properties.limits.timestampPeriod;
+        m_timestamp_mask = valid_bits >= 64 ? ~uint64_t{0} : (uint64_t{1} << valid_bits) - 1;
+
+        const VkQueryPoolCreateInfo timestamp_pool_info {
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .queryType = VK_QUERY_TYPE_TIMESTAMP,
+            .queryCount = p_frame_count * timestamps_per_frame,
+            .pipelineStatistics = 0,
+        };
+
+        const auto result = vkCreateQueryPool(m_device, &timestamp_pool_info, nullptr, &m_timestamp_pool);
+        if (result != VK_SUCCESS) {
+            throw vulkan_creation_exception_t{result, "timestamp query pool"};
+        }
+    }
+
+    if (m_device.get_enabled_features().pipelineStatisticsQuery == VK_FALSE) {
+        fmt::print(stderr, fmt::fg(fmt::color::yellow), "[WARNING]: The device doesn't support pipeline statistics queries.\n");
+    } else {
+        const VkQueryPoolCreateInfo statistics_pool_info {
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS,
+            .queryCount = p_frame_count,
+            .pipelineStatistics = statistic_flags,
+        };
+
+        const auto result = vkCreateQueryPool(m_device, &statistics_pool_info, nullptr, &m_statistics_pool);
+        if (result != VK_SUCCESS) {
+            vkDestroyQueryPool(m_device, m_timestamp_pool, nullptr);
+            throw vulkan_creation_exception_t{result, "pipeline statistics query pool"};
+        }
+
+        m_statistics_flags = statistic_flags;
+    }
+
+    m_regions.push_back(series_t{"frame", {}, 0});
+
+    for (const auto name : statistic_names) {
+        m_statistics.push_back(series_t{std::string{name}, {}, 0});
+    }
+
+    if (p_csv_path.has_value()) {
+        m_csv.open(p_csv_path.value());
+        if (!m_csv) {
+            vkDestroyQueryPool(m_device, m_statistics_pool, nullptr);
+            vkDestroyQueryPool(m_device, m_timestamp_pool, nullptr);
+            throw file_opening_exception_t{"profiler CSV file"};
+        }
+
+        // One row per value keeps the format the same no matter which regions show up.
+        m_csv << "frame,name,value\n";
+    }
+}
+
+auto gpu_profiler_t::begin_frame(VkCommandBuffer p_command_buffer, uint32_t p_frame_index) -> void {
+    collect(p_frame_index);
+
+    m_current_frame = p_frame_index;
+
+    auto& frame = m_frames[p_frame_index];
+    frame.pending = true;
+    frame.frame_number = m_frame_number++;
+    frame.regions.clear();
+    frame.open_regions.clear();
+    frame.has_statistics = false;
+
+    if (m_timestamp_pool != VK_NULL_HANDLE) {
+        vkCmdResetQueryPool(p_command_buffer, m_timestamp_pool, get_first_timestamp(p_frame_index), timestamps_per_frame);
+        vkCmdWriteTimestamp(p_command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_timestamp_pool, get_first_timestamp(p_frame_index));
+    }
+
+    if (m_statistics_pool != VK_NULL_HANDLE) {
+        vkCmdResetQueryPool(p_command_buffer, m_statistics_pool, p_frame_index, 1);
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now - m_last_report >= std::chrono::seconds{1}) {
+        report();
+        m_last_report = now;
+    }
+}
+
+auto gpu_profiler_t::end_frame(VkCommandBuffer p_command_buffer) -> void {
+    if (m_timestamp_pool != VK_NULL_HANDLE) {
+        vkCmdWriteTimestamp(p_command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestamp_pool, get_first_timestamp(m_current_frame) + 1);
+    }
+}
+
+auto gpu_profiler_t::begin_region(VkCommandBuffer p_command_buffer, std::string_view p_name) -> void {
+    auto& frame = m_frames[m_current_frame];
+
+    // Regions beyond the limit are quietly dropped, but still have to be ended.
+    if (frame.regions.size() >= max_regions) {
+        frame.open_regions.push_back(max_regions);
+        return;
+    }
+
+    auto region = std::find_if(m_regions.begin(), m_regions.end(), [&](const series_t& p_series) { return p_series.name == p_name; });
+    if (region == m_regions.end()) {
+        region = m_regions.insert(m_regions.end(), series_t{std::string{p_name}, {}, 0});
+    }
+
+    const auto slot = static_cast<uint32_t>(frame.regions.size());
+    frame.regions.push_back(static_cast<size_t>(region - m_regions.begin()));
+    frame.open_regions.push_back(slot);
+
+    if (m_timestamp_pool != VK_NULL_HANDLE) {
+        vkCmdWriteTimestamp(p_command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_timestamp_pool, get_first_timestamp(m_current_frame) + 2 + 2 * slot);
+    }
+}
+
+auto gpu_profiler_t::end_region(VkCommandBuffer p_command_buffer) -> void {
+    auto& frame = m_frames[m_current_frame];
+
+    const auto slot = frame.open_regions.back();
+    frame.open_regions.pop_back();
+
+    if (slot < max_regions && m_timestamp_pool != VK_NULL_HANDLE) {
+        vkCmdWriteTimestamp(p_command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestamp_pool, get_first_timestamp(m_current_frame) + 3 + 2 * slot);
+    }
+}
+
+auto gpu_profiler_t::begin_statistics(VkCommandBuffer p_command_buffer) -> void {
+    if (m_statistics_pool == VK_NULL_HANDLE) {
+        return;
+    }
+
+    vkCmdBeginQuery(p_command_buffer, m_statistics_pool, m_current_frame, 0);
+    m_frames[m_current_frame].has_statistics = true;
+}
+
+auto gpu_profiler_t::end_statistics(VkCommandBuffer p_command_buffer) -> void {
+    if (m_statistics_pool == VK_NULL_HANDLE) {
+        return;
+    }
+
+    vkCmdEndQuery(p_command_buffer, m_statistics_pool, m_current_frame);
+}
+
+auto gpu_profiler_t::flush() -> void {
+    // Oldest first, so that the frame times stay in order.
+    for (uint32_t i = 1; i <= m_frames.size(); i++) {
+        collect((m_current_frame + i) % m_frames.size());
+    }
+}
+
+auto gpu_profiler_t::collect(uint32_t p_frame_index) -> void {
+    auto& frame = m_frames[p_frame_index];
+    if (!frame.pending) {
+        return;
+    }
+
+    frame.pending = false;
+
+    // The frame has been waited on, so everything should be there already. If it
+    // isn't for some reason, the frame is just skipped instead of waiting for it.
+
+    if (m_timestamp_pool != VK_NULL_HANDLE) {
+        std::array<uint64_t, timestamps_per_frame> timestamps;
+        const auto query_count = 2 + 2 * static_cast<uint32_t>(frame.regions.size());
+
+        const auto result = vkGetQueryPoolResults(
+            m_device,
+            m_timestamp_pool,
+            get_first_timestamp(p_frame_index),
+            query_count,
+            query_count * sizeof(uint64_t),
+            timestamps.data(),
+            sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT
+        );
+
+        if (result == VK_SUCCESS) {
+            const auto to_milliseconds = [&](uint64_t p_begin, uint64_t p_end) {
+                return static_cast<double>((p_end - p_begin) & m_timestamp_mask) * m_timestamp_period / 1e6;
+            };
+
+            const auto frame_time = to_milliseconds(timestamps[0], timestamps[1]);
+            m_regions[0].add(frame_time);
+
+            if (m_keep_frame_times) {
+                m_frame_times.push_back(frame_time);
+            }
+
+            if (m_csv.is_open()) {
+                m_csv << frame.frame_number << ",frame_ms," << frame_time << '\n';
+            }
+
+            for (size_t i = 0; i < frame.regions.size(); i++) {
+                auto& region = m_regions[frame.regions[i]];
+                const auto region_time = to_milliseconds(timestamps[2 + 2 * i], timestamps[3 + 2 * i]);
+
+                region.add(region_time);
+
+                if (m_csv.is_open()) {
+                    m_csv << frame.frame_number << ',' << region.name << "_ms," << region_time << '\n';
+                }
+            }
+        } else if (result != VK_NOT_READY) {
+            throw generic_vulkan_exception_t{result, "Failed to read back the timestamp queries."};
+        }
+    }
+
+    if (frame.has_statistics) {
+        std::array<uint64_t, statistic_names.size()> statistics;
+
+        const auto result = vkGetQueryPoolResults(
+            m_device,
+            m_statistics_pool,
+            p_frame_index,
+            1,
+            sizeof(statistics),
+            statistics.data(),
+            sizeof(statistics),
+            VK_QUERY_RESULT_64_BIT
+        );
+
+        if (result == VK_SUCCESS) {
+            for (size_t i = 0; i < statistics.size(); i++) {
+                m_statistics[i].add(static_cast<double>(statistics[i]));
+
+                if (m_csv.is_open()) {
+                    m_csv << frame.frame_number << ',' << m_statistics[i].name << ',' << statistics[i] << '\n';
+                }
+            }
+        } else if (result != VK_NOT_READY) {
+            throw generic_vulkan_exception_t{result, "Failed to read back the pipeline statistics queries."};
+        }
+    }
+}
+
+auto gpu_profiler_t::report() -> void {
+    for (const auto& region : m_regions) {
+        if (region.samples.empty()) {
+            continue;
+        }
+
+        fmt::print(
+            stderr,
+            "[PROFILE]: {}: avg {:.3f} ms, p50 {:.3f} ms, p95 {:.3f} ms, p99 {:.3f} ms\n",
+            region.name,
+            region.get_average(),
+            region.get_percentile(50.0),
+            region.get_percentile(95.0),
+            region.get_percentile(99.0)
+        );
+    }
+
+    for (const auto& statistic : m_statistics) {
+        if (statistic.samples.empty()) {
+            continue;
+        }
+
+        fmt::print(stderr, "[PROFILE]: {}: avg {:.0f} per frame\n", statistic.name, statistic.get_average());
+    }
+}
+
+gpu_profiler_t::~gpu_profiler_t() noexcept {
+    vkDestroyQueryPool(m_device, m_statistics_pool, nullptr);
+    vkDestroyQueryPool(m_device, m_timestamp_pool, nullptr);
+}
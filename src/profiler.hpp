@@ -0,0 +1,122 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+#include "common.hpp"
+#include "devices.hpp"
+
+namespace pooper_cube {
+    // Measures how long the GPU spends on each frame (and on named regions of it) with
+    // timestamp queries, and counts shader invocations with pipeline statistics queries.
+    //
+    // Every frame in flight gets its own range of queries. The results are only read back
+    // once that frame comes around again, at which point it has already been waited on,
+    // so reading them never stalls anything.
+    class gpu_profiler_t {
+        public:
+            // Without a CSV path, the results only end up on stderr. Keeping the frame times
+            // holds on to the GPU time of every single frame, instead of just the last few.
+            gpu_profiler_t(
+                const physical_device_t& physical_device,
+                const device_t& device,
+                uint32_t frame_count,
+                std::optional<std::filesystem::path> csv_path,
+                bool keep_frame_times = false
+            );
+
+            NO_COPY(gpu_profiler_t);
+
+            // Must be called right after the command buffer of the frame has been begun, and
+            // only after the frame has been waited on. Picks up the results that the frame
+            // produced the last time around.
+            auto begin_frame(VkCommandBuffer command_buffer, uint32_t frame_index) -> void;
+            auto end_frame(VkCommandBuffer command_buffer) -> void;
+
+            // Regions can be nested, but must not be started inside of a render pass and
+            // ended outside of it (or the other way around). Regions with the same name are
+            // lumped together.
+            auto begin_region(VkCommandBuffer command_buffer, std::string_view name) -> void;
+            auto end_region(VkCommandBuffer command_buffer) -> void;
+
+            // Counts everything that happens in between. Can't be nested.
+            auto begin_statistics(VkCommandBuffer command_buffer) -> void;
+            auto end_statistics(VkCommandBuffer command_buffer) -> void;
+
+            // Reads back the results of every frame that is still outstanding. The device must
+            // be idle.
+            auto flush() -> void;
+
+            // In milliseconds, in the order that the frames were rendered in. Empty unless the
+            // frame times are kept.
+            auto get_frame_times() const noexcept -> std::span<const double> { return m_frame_times; }
+
+            // Secondary command buffers that run while statistics are being collected have to
+            // declare this in their inheritance info. Zero if the device can't collect any.
+            auto get_statistics_flags() const noexcept -> VkQueryPipelineStatisticFlags { return m_statistics_flags; }
+
+            ~gpu_profiler_t() noexcept;
+
+        private:
+            // Keeps the last few hundred samples of something around, for averages and
+            // percentiles.
+            struct series_t {
+                std::string name;
+                std::vector<double> samples;
+                size_t next_sample;
+
+                auto add(double sample) -> void;
+                auto get_average() const noexcept -> double;
+                auto get_percentile(double percentile) const -> double;
+            };
+
+            // What a frame in flight wrote into its range of queries.
+            struct frame_queries_t {
+                bool pending;
+                uint64_t frame_number;
+
+                // Indices into m_regions, in the order that the regions were started in.
+                std::vector<size_t> regions;
+                std::vector<uint32_t> open_regions;
+
+                bool has_statistics;
+            };
+
+            static constexpr uint32_t max_regions = 16;
+
+            // Two timestamps for the frame itself, and two for every region.
+            static constexpr uint32_t timestamps_per_frame = 2 + 2 * max_regions;
+
+            auto collect(uint32_t frame_index) -> void;
+            auto report() -> void;
+
+            auto get_first_timestamp(uint32_t frame_index) const noexcept -> uint32_t { return frame_index * timestamps_per_frame; }
+
+            const device_t& m_device;
+
+            VkQueryPool m_timestamp_pool;
+            VkQueryPool m_statistics_pool;
+            VkQueryPipelineStatisticFlags m_statistics_flags;
+
+            // Converts timestamp ticks into nanoseconds.
+            double m_timestamp_period;
+
+            // Timestamps only have this many valid bits, the rest is garbage.
+            uint64_t m_timestamp_mask;
+
+            std::vector<frame_queries_t> m_frames;
+            uint32_t m_current_frame;
+            uint64_t m_frame_number;
+
+            // The first series is always the whole frame.
+            std::vector<series_t> m_regions;
+            std::vector<series_t> m_statistics;
+
+            bool m_keep_frame_times;
+            std::vector<double> m_frame_times;
+
+            std::chrono::steady_clock::time_point m_last_report;
+            std::ofstream m_csv;
+    };
+}
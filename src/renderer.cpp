@@ -0,0 +1,1070 @@
+#include "images.hpp"
+
+#include "renderer.hpp"
+
+#include "shaders/animate-comp.hpp"
+#include "shaders/cull-comp.hpp"
+#include "shaders/triangle-frag.hpp"
+#include "shaders/triangle-vert.hpp"
+
+using pooper_cube::renderer_t;
+
+namespace {
+    // Only read when reloading the shaders. Relative to the working directory, which is
+    // where the build puts them when running from the build directory.
+    constexpr std::string_view vertex_shader_path = "shaders/triangle.vert.spv";
+    constexpr std::string_view fragment_shader_path = "shaders/triangle.frag.spv";
+
+    // Has to match the constant_ids in triangle.frag.
+    enum class specialization_constant_t : uint32_t {
+        animate_color,
+    };
+
+    auto get_subresource_range(VkImageAspectFlags p_aspect) -> VkImageSubresourceRange {
+        return VkImageSubresourceRange {
+            .aspectMask = p_aspect,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        };
+    }
+
+    // Layout transitions of a depth format with a stencil component have to cover both.
+    auto get_depth_aspect(VkFormat p_format) -> VkImageAspectFlags {
+        switch (p_format) {
+            case VK_FORMAT_D32_SFLOAT_S8_UINT:
+            case VK_FORMAT_D24_UNORM_S8_UINT:
+                return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+            default:
+                return VK_IMAGE_ASPECT_DEPTH_BIT;
+        }
+    }
+
+    auto get_pipeline_state() -> pooper_cube::graphics_pipeline_state_t {
+        auto state = pooper_cube::default_pipeline_state;
+
+        state.specialization_constant_count = 1;
+        state.specialization_constants[static_cast<uint32_t>(specialization_constant_t::animate_color)] = VK_TRUE;
+
+        return state;
+    }
+
+    auto align_region_size(VkDeviceSize p_size, VkDeviceSize p_alignment) -> VkDeviceSize {
+        return (p_size + p_alignment - 1) / p_alignment * p_alignment;
+    }
+
+    // The animated copies have to start at offsets that they can be bound at.
+    auto get_instance_region_size(size_t p_instance_count, bool p_animated, VkDeviceSize p_alignment) -> VkDeviceSize {
+        const auto size = static_cast<VkDeviceSize>(p_instance_count * sizeof(pooper_cube::instance_data_t));
+        return p_animated ? align_region_size(size, p_alignment) : size;
+    }
+
+    // Every cube gets an axis and a speed of its own, which only depend on its index, so
+    // that the animation is the same on every run. Has to match animate.comp.
+    auto get_angular_velocity(uint32_t p_index) -> glm::vec3 {
+        auto hash = p_index * 0x9e3779b9u;
+
+        // Mixes the hash up some more every time, and turns it into something in [0, 1].
+        const auto next = [&]() {
+            hash ^= hash >> 15;
+            hash *= 0x2c1b3c6du;
+            hash ^= hash >> 12;
+            return static_cast<float>(hash & 0xffff) / 65535.0f;
+        };
+
+        const glm::vec3 axis{next() * 2.0f - 1.0f, next() * 2.0f - 1.0f, next() * 2.0f - 1.0f};
+        const auto length = glm::length(axis);
+
+        // Somewhere between a twelfth of a turn and a third of one per second.
+        const auto speed = 0.5f + 1.5f * next();
+
+        return length > 0.001f ? axis * (speed / length) : glm::vec3{0.0f, speed, 0.0f};
+    }
+}
+
+renderer_t::renderer_t(
+    const physical_device_t& p_physical_device,
+    const device_t& p_device,
+    allocator_t& p_allocator,
+    submission_tracker_t& p_submissions,
+    upload_manager_t& p_uploads,
+    job_system_t& p_jobs,
+    const pipeline_cache_t& p_pipeline_cache,
+    VkFormat p_color_format,
+    VkImageLayout p_final_layout,
+    const settings_t& p_settings,
+    gpu_profiler_t* p_profiler
+) :
+    m_device(p_device),
+    m_submissions(p_submissions),
+    m_uploads(p_uploads),
+    m_jobs(p_jobs),
+    m_pipeline_cache(p_pipeline_cache),
+    m_profiler(p_profiler),
+    m_command_pool(p_device, p_physical_device.graphics_queue_family),
+    m_bindless(p_physical_device, p_device, p_submissions),
+    // Binding 0 points into the uniform ring, at whatever offset the frame got for its
+    // constants. Push descriptor sets can't hold dynamic descriptors, so the offset gets
+    // pushed along with the buffer in that case.
+    m_descriptor_layout(
+        p_device,
+        std::array<VkDescriptorSetLayoutBinding, 1> {
+            VkDescriptorSetLayoutBinding {
+                .binding = 0,
+                .descriptorType = p_device.has_push_descriptors() ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                .descriptorCount = 1,
+                .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT,
+                .pImmutableSamplers = nullptr
+            },
+        },
+        p_device.has_push_descriptors() ? static_cast<VkDescriptorSetLayoutCreateFlags>(VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR) : 0
+    ),
+    m_descriptor_allocator{},
+    m_uniform_set(VK_NULL_HANDLE),
+    m_pipeline_layout(
+        p_device,
+        std::array<VkDescriptorSetLayout, 2>{m_descriptor_layout, m_bindless.get_layout()},
+        std::array<VkPushConstantRange, 1> {
+            VkPushConstantRange {
+                .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_VERTEX_BIT,
+                .offset = 0,
+                .size = sizeof(push_constants_t),
+            }
+        }
+    ),
+    m_uniform_template(
+        p_device.has_push_descriptors()
+            ? std::make_unique<descriptor_update_template_t>(p_device, m_descriptor_layout, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout, 0)
+            : std::make_unique<descriptor_update_template_t>(p_device, m_descriptor_layout)
+    ),
+    m_color_format(p_color_format),
+    m_depth_format(find_depth_format(p_physical_device).value()),
+    m_final_layout(p_final_layout),
+    m_render_pass(p_device.has_dynamic_rendering() ? nullptr : std::make_unique<render_pass_t>(p_device, p_color_format, m_depth_format, p_final_layout)),
+    m_pipelines(std::make_unique<pipeline_variants_t>(
+        p_device,
+        std::make_unique<shader_module_t>(p_device, shader_module_t::type_t::vertex, shaders::triangle_vert),
+        std::make_unique<shader_module_t>(p_device, shader_module_t::type_t::fragment, shaders::triangle_frag),
+        m_pipeline_layout,
+        get_pipeline_target(),
+        p_pipeline_cache
+    )),
+    m_pipeline_state(get_pipeline_state()),
+    m_mesh(generate_cube(1.0f)),
+    m_vertex_buffer(p_allocator, buffer_t::type_t::vertex, m_mesh.vertices.size() * sizeof(m_mesh.vertices[0])),
+    m_index_buffer(p_allocator, buffer_t::type_t::element, m_mesh.indices.size() * sizeof(m_mesh.indices[0])),
+    m_instances(p_settings.nested_cubes ? generate_nested_cubes(p_settings.cube_count, p_jobs) : generate_cube_grid(p_settings.cube_count, p_jobs)),
+    m_instance_region_size(get_instance_region_size(m_instances.size(), p_settings.animation == animation_t::cpu, instance_region_alignment)),
+    m_instance_buffer(
+        p_settings.animation == animation_t::cpu
+            ? std::unique_ptr<buffer_t>{std::make_unique<host_coherent_buffer_t>(p_allocator, buffer_t::type_t::streamed_instance, m_instance_region_size * p_settings.frames_in_flight)}
+            : std::make_unique<buffer_t>(p_allocator, buffer_t::type_t::instance, m_instance_region_size)
+    ),
+    m_mapped_instances(nullptr),
+    m_instance_buffer_indices{},
+    m_transforms(p_settings.animation == animation_t::cpu ? std::make_unique<transform_store_t>(m_instances, p_settings.frames_in_flight) : nullptr),
+    m_last_time{},
+    m_transform_update_time{},
+    m_mesh_upload{queue_kind_t::transfer, 0},
+    m_upload_wait{},
+    m_mesh_upload_waited_on(false),
+    // Zero means all of them.
+    m_cubes_per_draw(std::max(p_settings.cubes_per_draw == 0 ? static_cast<uint32_t>(m_instances.size()) : p_settings.cubes_per_draw, 1u)),
+    m_draw_count(p_settings.gpu_culling ? 1 : (static_cast<uint32_t>(m_instances.size()) + m_cubes_per_draw - 1) / m_cubes_per_draw),
+    m_culling(
+        p_settings.gpu_culling
+            ? std::make_unique<culling_t>(
+                p_allocator,
+                p_pipeline_cache,
+                m_descriptor_layout,
+                m_bindless.get_layout(),
+                m_instances.size() * sizeof(m_instances[0])
+            )
+            : nullptr
+    ),
+    m_gpu_animation(
+        p_settings.animation == animation_t::gpu
+            ? std::make_unique<gpu_animation_t>(
+                p_allocator,
+                p_pipeline_cache,
+                m_descriptor_layout,
+                m_bindless.get_layout(),
+                m_instances.size() * sizeof(m_instances[0])
+            )
+            : nullptr
+    ),
+    // Culling on the GPU already leaves nothing for the CPU to throw away. Spinning cubes
+    // get loose bounds, so that the tree never has to be refitted.
+    m_cpu_culling(
+        p_settings.cpu_culling && !p_settings.gpu_culling
+            ? std::make_unique<cpu_culling_t>(
+                p_allocator,
+                m_instances,
+                p_settings.animation != animation_t::none,
+                p_settings.frames_in_flight,
+                p_jobs
+            )
+            : nullptr
+    ),
+    m_cpu_culling_time{},
+    m_uniforms(p_allocator, p_settings.frames_in_flight, uniform_ring_frame_size),
+    m_frames(
+        p_settings.frames_in_flight,
+        p_physical_device,
+        p_device,
+        p_submissions,
+        m_command_pool,
+        p_settings.recording_threads > 1 ? p_settings.recording_threads : 0
+    ),
+    m_retired(p_submissions, p_settings.frames_in_flight),
+    m_rebuild_requested(false)
+{
+    // Built right away, so that the first frame doesn't have to wait for it.
+    m_pipelines->get(m_pipeline_state);
+
+    // The copies run on the transfer queue while we get on with rendering.
+    m_uploads.upload(m_vertex_buffer, std::as_bytes(std::span{m_mesh.vertices}));
+    m_uploads.upload(m_index_buffer, std::as_bytes(std::span{m_mesh.indices}));
+
+    // Animated instances are written by every frame, so there's nothing to upload.
+    if (m_transforms == nullptr) {
+        m_uploads.upload(*m_instance_buffer, std::as_bytes(std::span{m_instances}));
+    } else {
+        m_mapped_instances = static_cast<std::byte*>(static_cast<void*>(static_cast<const host_coherent_buffer_t&>(*m_instance_buffer).map_memory()));
+
+        for (uint32_t i = 0; i < m_transforms->get_count(); i++) {
+            m_transforms->set_angular_velocity(i, get_angular_velocity(i));
+        }
+    }
+
+    m_mesh_upload = m_uploads.submit();
+
+    // Without push descriptors, a single set 0 does for every frame. It always points at
+    // the same buffer, and the frames pick out their slice of it with a dynamic offset, so
+    // it's written once and never again.
+    if (!p_device.has_push_descriptors()) {
+        const std::array<VkDescriptorPoolSize, 1> pool_sizes {
+            VkDescriptorPoolSize {
+                .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                .descriptorCount = 1,
+            },
+        };
+
+        m_descriptor_allocator = std::make_unique<descriptor_allocator_t>(p_device, pool_sizes, 1);
+        m_uniform_set = m_descriptor_allocator->allocate(m_descriptor_layout);
+
+        const VkDescriptorBufferInfo uniform_buffer {
+            .buffer = m_uniforms,
+            .offset = 0,
+            .range = sizeof(uniform_buffer_object_t),
+        };
+
+        m_uniform_template->update(m_uniform_set, &uniform_buffer);
+    }
+
+    // These live for as long as the table does, so they never have to be removed again.
+    const uint32_t instance_region_count = m_transforms != nullptr ? p_settings.frames_in_flight : 1;
+    for (uint32_t i = 0; i < instance_region_count; i++) {
+        m_instance_buffer_indices.push_back(m_bindless.add_storage_buffer(*m_instance_buffer, i * m_instance_region_size, m_instances.size() * sizeof(m_instances[0])));
+    }
+
+    if (m_gpu_animation != nullptr) {
+        m_gpu_animation->animated_instance_buffer_index = m_bindless.add_storage_buffer(m_gpu_animation->animated_instance_buffer);
+    }
+
+    if (m_cpu_culling != nullptr) {
+        for (uint32_t i = 0; i < p_settings.frames_in_flight; i++) {
+            m_cpu_culling->visible_index_buffer_indices.push_back(m_bindless.add_storage_buffer(
+                m_cpu_culling->visible_index_buffer,
+                i * m_cpu_culling->region_size,
+                m_instances.size() * sizeof(uint32_t)
+            ));
+        }
+    }
+
+    if (m_culling == nullptr) {
+        return;
+    }
+
+    m_culling->visible_instance_buffer_index = m_bindless.add_storage_buffer(m_culling->visible_instance_buffer);
+    m_culling->draw_command_buffer_index = m_bindless.add_storage_buffer(m_culling->draw_command_buffer);
+}
+
+renderer_t::culling_t::culling_t(
+    allocator_t& p_allocator,
+    const pipeline_cache_t& p_pipeline_cache,
+    const descriptor_layout_t& p_uniform_layout,
+    const descriptor_layout_t& p_bindless_layout,
+    VkDeviceSize p_instance_buffer_size
+) :
+    compute_shader(p_allocator.get_device(), shader_module_t::type_t::compute, shaders::cull_comp),
+    pipeline_layout(
+        p_allocator.get_device(),
+        std::array<VkDescriptorSetLayout, 2>{p_uniform_layout, p_bindless_layout},
+        std::array<VkPushConstantRange, 1> {
+            VkPushConstantRange {
+                .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .offset = 0,
+                .size = sizeof(cull_push_constants_t),
+            }
+        }
+    ),
+    pipeline(p_allocator.get_device(), compute_shader, pipeline_layout, p_pipeline_cache),
+    uniform_template(
+        p_allocator.get_device().has_push_descriptors()
+            ? std::make_unique<descriptor_update_template_t>(p_allocator.get_device(), p_uniform_layout, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout, 0)
+            : nullptr
+    ),
+    visible_instance_buffer(p_allocator, buffer_t::type_t::instance, p_instance_buffer_size),
+    draw_command_buffer(p_allocator, buffer_t::type_t::indirect, sizeof(VkDrawIndexedIndirectCommand)),
+    // Filled in once the buffers have been added to the bindless table.
+    visible_instance_buffer_index(0),
+    draw_command_buffer_index(0)
+{}
+
+renderer_t::gpu_animation_t::gpu_animation_t(
+    allocator_t& p_allocator,
+    const pipeline_cache_t& p_pipeline_cache,
+    const descriptor_layout_t& p_uniform_layout,
+    const descriptor_layout_t& p_bindless_layout,
+    VkDeviceSize p_instance_buffer_size
+) :
+    compute_shader(p_allocator.get_device(), shader_module_t::type_t::compute, shaders::animate_comp),
+    // Set 0 isn't used, but it's there anyway, so that the bindless table is set 1 in
+    // every pipeline.
+    pipeline_layout(
+        p_allocator.get_device(),
+        std::array<VkDescriptorSetLayout, 2>{p_uniform_layout, p_bindless_layout},
+        std::array<VkPushConstantRange, 1> {
+            VkPushConstantRange {
+                .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .offset = 0,
+                .size = sizeof(animate_push_constants_t),
+            }
+        }
+    ),
+    pipeline(p_allocator.get_device(), compute_shader, pipeline_layout, p_pipeline_cache),
+    animated_instance_buffer(p_allocator, buffer_t::type_t::instance, p_instance_buffer_size),
+    // Filled in once the buffer has been added to the bindless table.
+    animated_instance_buffer_index(0)
+{}
+
+renderer_t::cpu_culling_t::cpu_culling_t(
+    allocator_t& p_allocator,
+    std::span<const instance_data_t> p_instances,
+    bool p_loose_bounds,
+    uint32_t p_frame_count,
+    job_system_t& p_jobs
+) :
+    bvh(p_instances, p_loose_bounds, p_jobs),
+    visible_instances{},
+    region_size(align_region_size(p_instances.size() * sizeof(uint32_t), instance_region_alignment)),
+    visible_index_buffer(p_allocator, buffer_t::type_t::streamed_instance, region_size * p_frame_count),
+    mapped_visible_indices(static_cast<std::byte*>(static_cast<void*>(visible_index_buffer.map_memory()))),
+    // Filled in once the regions have been added to the bindless table.
+    visible_index_buffer_indices{}
+{
+    visible_instances.reserve(p_instances.size());
+}
+
+auto renderer_t::record_animation(VkCommandBuffer p_command_buffer, double p_time) const -> void {
+    // The previous frame may still be reading the instances that we are about to
+    // overwrite, either to draw them or to cull them.
+    vkCmdPipelineBarrier(
+        p_command_buffer,
+        VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 0, nullptr, 0, nullptr, 0, nullptr
+    );
+
+    vkCmdBindPipeline(p_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_gpu_animation->pipeline);
+
+    const VkDescriptorSet bindless_set = m_bindless;
+    vkCmdBindDescriptorSets(p_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_gpu_animation->pipeline_layout, 1, 1, &bindless_set, 0, nullptr);
+
+    const animate_push_constants_t push_constants {
+        .time = static_cast<float>(p_time),
+        .instance_count = static_cast<uint32_t>(m_instances.size()),
+        .rest_instance_buffer = m_instance_buffer_indices[0],
+        .animated_instance_buffer = m_gpu_animation->animated_instance_buffer_index,
+    };
+
+    vkCmdPushConstants(p_command_buffer, m_gpu_animation->pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants), &push_constants);
+
+    // Has to match the local size in the shader.
+    constexpr uint32_t workgroup_size = 64;
+    vkCmdDispatch(p_command_buffer, (push_constants.instance_count + workgroup_size - 1) / workgroup_size, 1, 1);
+
+    // Read by the culling shader, if there is one, and by the vertex shader otherwise.
+    const VkMemoryBarrier animation_barrier {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .pNext = nullptr,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+    };
+
+    vkCmdPipelineBarrier(
+        p_command_buffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+        0, 1, &animation_barrier, 0, nullptr, 0, nullptr
+    );
+}
+
+auto renderer_t::record_culling(VkCommandBuffer p_command_buffer, uint32_t p_instance_buffer, const frame_descriptors_t& p_descriptors, const glm::mat4& p_model) const -> void {
+    // The previous frame may still be drawing from the buffers that we are about to
+    // overwrite, so wait for it to get past the point where it reads them. Reads don't
+    // need to be made visible to anything, so an execution dependency is enough.
+    vkCmdPipelineBarrier(
+        p_command_buffer,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 0, nullptr, 0, nullptr, 0, nullptr
+    );
+
+    // The shader only ever adds to the instance count, so it has to start from zero.
+    const VkDrawIndexedIndirectCommand draw_command {
+        .indexCount = static_cast<uint32_t>(m_mesh.indices.size()),
+        .instanceCount = 0,
+        .firstIndex = 0,
+        .vertexOffset = 0,
+        .firstInstance = 0,
+    };
+
+    vkCmdUpdateBuffer(p_command_buffer, m_culling->draw_command_buffer, 0, sizeof(draw_command), &draw_command);
+
+    const VkMemoryBarrier reset_barrier {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .pNext = nullptr,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+    };
+
+    vkCmdPipelineBarrier(
+        p_command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &reset_barrier, 0, nullptr, 0, nullptr
+    );
+
+    vkCmdBindPipeline(p_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_culling->pipeline);
+
+    bind_descriptors(
+        p_command_buffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        m_culling->pipeline_layout,
+        m_culling->uniform_template != nullptr ? *m_culling->uniform_template : *m_uniform_template,
+        p_descriptors
+    );
+
+    const cull_push_constants_t push_constants {
+        .model = p_model,
+        .instance_count = static_cast<uint32_t>(m_instances.size()),
+        .instance_buffer = p_instance_buffer,
+        .visible_instance_buffer = m_culling->visible_instance_buffer_index,
+        .draw_command_buffer = m_culling->draw_command_buffer_index,
+    };
+
+    vkCmdPushConstants(p_command_buffer, m_culling->pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants), &push_constants);
+
+    // Has to match the local size in the shader.
+    constexpr uint32_t workgroup_size = 64;
+    vkCmdDispatch(p_command_buffer, (push_constants.instance_count + workgroup_size - 1) / workgroup_size, 1, 1);
+
+    const VkMemoryBarrier cull_barrier {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .pNext = nullptr,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+    };
+
+    vkCmdPipelineBarrier(
+        p_command_buffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+        0, 1, &cull_barrier, 0, nullptr, 0, nullptr
+    );
+}
+
+auto renderer_t::get_instance_region(uint32_t p_frame_index) const noexcept -> uint32_t {
+    return m_transforms != nullptr ? p_frame_index : 0;
+}
+
+auto renderer_t::get_instance_buffer_index(uint32_t p_frame_index) const noexcept -> uint32_t {
+    return m_gpu_animation != nullptr
+        ? m_gpu_animation->animated_instance_buffer_index
+        : m_instance_buffer_indices[get_instance_region(p_frame_index)];
+}
+
+auto renderer_t::bind_descriptors(
+    VkCommandBuffer p_command_buffer,
+    VkPipelineBindPoint p_bind_point,
+    VkPipelineLayout p_pipeline_layout,
+    const descriptor_update_template_t& p_push_template,
+    const frame_descriptors_t& p_descriptors
+) const -> void {
+    const VkDescriptorSet bindless_set = m_bindless;
+
+    if (p_descriptors.uniform_set == VK_NULL_HANDLE) {
+        p_push_template.push(p_command_buffer, &p_descriptors.uniform_buffer);
+        vkCmdBindDescriptorSets(p_command_buffer, p_bind_point, p_pipeline_layout, 1, 1, &bindless_set, 0, nullptr);
+        return;
+    }
+
+    // The uniforms and the whole bindless table, in one go. The set covers the start of
+    // the ring, and the offset moves it to the frame's slice.
+    const std::array<VkDescriptorSet, 2> descriptor_sets{p_descriptors.uniform_set, bindless_set};
+    const auto uniform_offset = static_cast<uint32_t>(p_descriptors.uniform_buffer.offset);
+    vkCmdBindDescriptorSets(p_command_buffer, p_bind_point, p_pipeline_layout, 0, descriptor_sets.size(), descriptor_sets.data(), 1, &uniform_offset);
+}
+
+auto renderer_t::begin_rendering(VkCommandBuffer p_command_buffer, const render_target_t& p_target, bool p_secondary_command_buffers) const -> void {
+    const std::array<VkClearValue, 2> clear_values {
+        VkClearValue {
+            .color = {
+                .float32 = {
+                    0.0f, 0.0f, 0.0f, 1.0f
+                }
+            }
+        },
+        VkClearValue {
+            .depthStencil = {
+                .depth = 1.0f,
+                .stencil = 0,
+            }
+        }
+    };
+
+    const VkRect2D render_area {
+        .offset = {
+            .x = 0,
+            .y = 0,
+        },
+        .extent = p_target.extent
+    };
+
+    if (m_render_pass != nullptr) {
+        const VkRenderPassBeginInfo render_pass_begin_info {
+            .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+            .pNext = nullptr,
+            .renderPass = *m_render_pass,
+            .framebuffer = p_target.framebuffer,
+            .renderArea = render_area,
+            .clearValueCount = clear_values.size(),
+            .pClearValues = clear_values.data(),
+        };
+
+        vkCmdBeginRenderPass(
+            p_command_buffer,
+            &render_pass_begin_info,
+            p_secondary_command_buffers ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE
+        );
+
+        return;
+    }
+
+    // The same as the external dependency of the render pass. The color image is waited on
+    // at the stage that the acquire semaphore is waited on at, and the depth buffer, which
+    // the frames in flight share, has to wait for the previous frame to stop writing to
+    // it. Both are cleared anyway, so their old contents can be thrown away.
+    const std::array<VkImageMemoryBarrier, 2> barriers {
+        VkImageMemoryBarrier {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = 0,
+            .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = p_target.color_image,
+            .subresourceRange = get_subresource_range(VK_IMAGE_ASPECT_COLOR_BIT),
+        },
+        VkImageMemoryBarrier {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = p_target.depth_image,
+            .subresourceRange = get_subresource_range(get_depth_aspect(m_depth_format)),
+        },
+    };
+
+    vkCmdPipelineBarrier(
+        p_command_buffer,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        barriers.size(), barriers.data()
+    );
+
+    const VkRenderingAttachmentInfo color_attachment {
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+        .pNext = nullptr,
+        .imageView = p_target.color_view,
+        .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        .resolveMode = VK_RESOLVE_MODE_NONE,
+        .resolveImageView = VK_NULL_HANDLE,
+        .resolveImageLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .clearValue = clear_values[0],
+    };
+
+    const VkRenderingAttachmentInfo depth_attachment {
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+        .pNext = nullptr,
+        .imageView = p_target.depth_view,
+        .imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+        .resolveMode = VK_RESOLVE_MODE_NONE,
+        .resolveImageView = VK_NULL_HANDLE,
+        .resolveImageLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .clearValue = clear_values[1],
+    };
+
+    const VkRenderingInfo rendering_info {
+        .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+        .pNext = nullptr,
+        .flags = p_secondary_command_buffers ? static_cast<VkRenderingFlags>(VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT) : 0,
+        .renderArea = render_area,
+        .layerCount = 1,
+        .viewMask = 0,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &color_attachment,
+        .pDepthAttachment = &depth_attachment,
+        .pStencilAttachment = nullptr,
+    };
+
+    vkCmdBeginRendering(p_command_buffer, &rendering_info);
+}
+
+auto renderer_t::end_rendering(VkCommandBuffer p_command_buffer, const render_target_t& p_target) const -> void {
+    if (m_render_pass != nullptr) {
+        vkCmdEndRenderPass(p_command_buffer);
+        return;
+    }
+
+    vkCmdEndRendering(p_command_buffer);
+
+    // The render pass would have moved the color image into its final layout at the very
+    // end, with an implicit dependency on everything that came before.
+    const VkImageMemoryBarrier barrier {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .pNext = nullptr,
+        .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        .dstAccessMask = 0,
+        .oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        .newLayout = m_final_layout,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = p_target.color_image,
+        .subresourceRange = get_subresource_range(VK_IMAGE_ASPECT_COLOR_BIT),
+    };
+
+    vkCmdPipelineBarrier(
+        p_command_buffer,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &barrier
+    );
+}
+
+auto renderer_t::get_pipeline_target() const noexcept -> pipeline_target_t {
+    return pipeline_target_t {
+        .render_pass = m_render_pass != nullptr ? static_cast<VkRenderPass>(*m_render_pass) : VK_NULL_HANDLE,
+        .color_format = m_color_format,
+        .depth_format = m_depth_format,
+    };
+}
+
+auto renderer_t::record(const frame_t& p_frame, const render_target_t& p_target, double p_time) -> void {
+    const auto command_buffer = p_frame.get_command_buffer();
+
+    // The recording threads all read the pipeline, so it's only ever switched out in
+    // between frames.
+    swap_in_rebuilt_pipeline();
+    m_retired.collect();
+    m_bindless.collect();
+
+    const auto pipeline = m_pipelines->get(m_pipeline_state);
+
+    const VkCommandBufferBeginInfo command_buffer_begin_info {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .pInheritanceInfo = nullptr,
+    };
+
+    auto result = vkBeginCommandBuffer(command_buffer, &command_buffer_begin_info);
+    if (result != VK_SUCCESS) {
+        throw generic_vulkan_exception_t{result, "Failed to start recording the command buffer!"};
+    }
+
+    if (m_profiler != nullptr) {
+        m_profiler->begin_frame(command_buffer, p_frame.get_index());
+    }
+
+    const auto scene_model = glm::rotate(glm::mat4{1.0f}, glm::radians(static_cast<float>(p_time*50.0f)), glm::vec3{1.0f, 0.5f, 0.0f});
+
+    const auto aspect_ratio = static_cast<float>(p_target.extent.width) / static_cast<float>(p_target.extent.height);
+
+    const uniform_buffer_object_t uniform_buffer_object {
+        .view = glm::translate(glm::mat4{1.0f} , glm::vec3{0.0f, 0.0f, -4.0f}),
+        .projection = glm::perspective(glm::radians(70.0f), aspect_ratio, 0.01f, 100.0f),
+        .color_offset = static_cast<float>(std::cos(p_time) / 2 + 0.5),
+    };
+
+    // The frame has been waited on, so whatever it put into the ring last time is no
+    // longer needed.
+    m_uniforms.begin_frame(p_frame.get_index());
+
+    frame_descriptors_t descriptors {
+        .uniform_set = m_uniform_set,
+        .uniform_buffer = VkDescriptorBufferInfo {
+            .buffer = m_uniforms,
+            .offset = m_uniforms.push(uniform_buffer_object),
+            .range = sizeof(uniform_buffer_object_t),
+        },
+    };
+
+    // The frame's copy of the instances isn't being drawn from anymore either, so the
+    // transforms can go straight into it.
+    if (m_transforms != nullptr) {
+        const auto update_start = std::chrono::steady_clock::now();
+        const auto instance_offset = get_instance_region(p_frame.get_index()) * m_instance_region_size;
+
+        // Nothing moves on the first frame, since there's nothing to measure the time from.
+        const auto delta_time = m_last_time.has_value() ? static_cast<float>(p_time - m_last_time.value()) : 0.0f;
+        m_last_time = p_time;
+
+        m_transforms->update(delta_time, p_frame.get_index(), reinterpret_cast<instance_data_t*>(m_mapped_instances + instance_offset), m_jobs);
+        m_transform_update_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - update_start).count();
+    }
+
+    // Culling on the CPU leaves a list of the cubes that survived in the frame's region of
+    // the index buffer, and only those get drawn. The scene's spin goes into the frustum,
+    // the same way that the culling shader does it.
+    auto drawn_instance_count = static_cast<uint32_t>(m_instances.size());
+    auto instance_index_buffer = push_constants_t::no_instance_indices;
+
+    if (m_cpu_culling != nullptr) {
+        const auto culling_start = std::chrono::steady_clock::now();
+        auto& visible_instances = m_cpu_culling->visible_instances;
+
+        m_cpu_culling->bvh.cull(uniform_buffer_object.projection * uniform_buffer_object.view * scene_model, m_jobs, visible_instances);
+        std::memcpy(
+            m_cpu_culling->mapped_visible_indices + p_frame.get_index() * m_cpu_culling->region_size,
+            visible_instances.data(),
+            visible_instances.size() * sizeof(visible_instances[0])
+        );
+
+        drawn_instance_count = static_cast<uint32_t>(visible_instances.size());
+        instance_index_buffer = m_cpu_culling->visible_index_buffer_indices[p_frame.get_index()];
+        m_cpu_culling_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - culling_start).count();
+    }
+
+    // The animation shader spins the whole scene along with the cubes. Whatever comes
+    // out of GPU culling gets drawn instead of the instances themselves.
+    const push_constants_t push_constants {
+        .model = m_gpu_animation != nullptr ? glm::mat4{1.0f} : scene_model,
+        .color_offset = static_cast<float>(std::sin(p_time) / 2 + 0.5),
+        .instance_buffer = m_culling != nullptr ? m_culling->visible_instance_buffer_index : get_instance_buffer_index(p_frame.get_index()),
+        .instance_index_buffer = instance_index_buffer,
+    };
+
+    // Fewer cubes to draw means fewer draws, too.
+    const auto draw_count = m_cpu_culling != nullptr ? (drawn_instance_count + m_cubes_per_draw - 1) / m_cubes_per_draw : m_draw_count;
+
+    // Drawing from the buffers while they're still being copied into would be bad.
+    const bool uploaded = m_uploads.is_complete(m_mesh_upload);
+
+    m_upload_wait.reset();
+    if (uploaded && !m_mesh_upload_waited_on) {
+        m_upload_wait = m_mesh_upload;
+        m_mesh_upload_waited_on = true;
+    }
+
+    // With culling, there's only one draw left anyway, so there's nothing to split up.
+    const bool record_in_parallel = uploaded && !p_frame.get_secondary_command_buffers().empty() && m_culling == nullptr;
+
+    // Secondary command buffers can only be executed while a query is active if the
+    // device lets them inherit it.
+    const bool collect_statistics = m_profiler != nullptr && (!record_in_parallel || m_device.get_enabled_features().inheritedQueries == VK_TRUE);
+
+    if (collect_statistics) {
+        m_profiler->begin_statistics(command_buffer);
+    }
+
+    // The animation has to wait for the instances that it starts from to be uploaded.
+    if (uploaded && m_gpu_animation != nullptr) {
+        if (m_profiler != nullptr) {
+            m_profiler->begin_region(command_buffer, "animation");
+        }
+
+        record_animation(command_buffer, p_time);
+
+        if (m_profiler != nullptr) {
+            m_profiler->end_region(command_buffer);
+        }
+    }
+
+    // Culling has to happen outside of the render pass.
+    if (uploaded && m_culling != nullptr) {
+        if (m_profiler != nullptr) {
+            m_profiler->begin_region(command_buffer, "culling");
+        }
+
+        record_culling(command_buffer, get_instance_buffer_index(p_frame.get_index()), descriptors, push_constants.model);
+
+        if (m_profiler != nullptr) {
+            m_profiler->end_region(command_buffer);
+        }
+    }
+
+    if (m_profiler != nullptr) {
+        m_profiler->begin_region(command_buffer, "render pass");
+    }
+
+    begin_rendering(command_buffer, p_target, record_in_parallel);
+
+    if (record_in_parallel) {
+        const auto secondary_command_buffers = p_frame.get_secondary_command_buffers();
+        const auto slice_count = static_cast<uint32_t>(secondary_command_buffers.size());
+
+        // With dynamic rendering, the secondary command buffers only get told the formats
+        // of the attachments.
+        const VkCommandBufferInheritanceRenderingInfo inheritance_rendering_info {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .viewMask = 0,
+            .colorAttachmentCount = 1,
+            .pColorAttachmentFormats = &m_color_format,
+            .depthAttachmentFormat = m_depth_format,
+            .stencilAttachmentFormat = VK_FORMAT_UNDEFINED,
+            .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+        };
+
+        const VkCommandBufferInheritanceInfo inheritance_info {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+            .pNext = m_render_pass == nullptr ? &inheritance_rendering_info : nullptr,
+            .renderPass = m_render_pass != nullptr ? static_cast<VkRenderPass>(*m_render_pass) : VK_NULL_HANDLE,
+            .subpass = 0,
+            .framebuffer = p_target.framebuffer,
+            .occlusionQueryEnable = VK_FALSE,
+            .queryFlags = 0,
+            .pipelineStatistics = collect_statistics ? m_profiler->get_statistics_flags() : 0,
+        };
+
+        // Each job gets an (almost) equal slice of the draws, and its own command buffer
+        // from its own pool to record them into, so it doesn't matter which threads end up
+        // running them. We help out with them while we wait.
+        const auto record_slice = [&](uint32_t p_slice) {
+            const auto secondary_command_buffer = secondary_command_buffers[p_slice];
+
+            const VkCommandBufferBeginInfo secondary_begin_info {
+                .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                .pNext = nullptr,
+                .flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+                .pInheritanceInfo = &inheritance_info,
+            };
+
+            auto secondary_result = vkBeginCommandBuffer(secondary_command_buffer, &secondary_begin_info);
+            if (secondary_result != VK_SUCCESS) {
+                throw generic_vulkan_exception_t{secondary_result, "Failed to start recording a secondary command buffer!"};
+            }
+
+            const auto first_draw = static_cast<uint32_t>(static_cast<uint64_t>(draw_count) * p_slice / slice_count);
+            const auto end_draw = static_cast<uint32_t>(static_cast<uint64_t>(draw_count) * (p_slice + 1) / slice_count);
+
+            record_draws(secondary_command_buffer, pipeline, descriptors, p_target.extent, push_constants, drawn_instance_count, first_draw, end_draw - first_draw);
+
+            secondary_result = vkEndCommandBuffer(secondary_command_buffer);
+            if (secondary_result != VK_SUCCESS) {
+                throw generic_vulkan_exception_t{secondary_result, "Failed to stop recording a secondary command buffer"};
+            }
+        };
+
+        job_counter_t recorded;
+        for (uint32_t slice = 0; slice < slice_count; slice++) {
+            m_jobs.submit([&record_slice, slice]() { record_slice(slice); }, recorded);
+        }
+
+        m_jobs.wait(recorded);
+
+        vkCmdExecuteCommands(command_buffer, slice_count, secondary_command_buffers.data());
+    } else {
+        record_draws(command_buffer, pipeline, descriptors, p_target.extent, push_constants, drawn_instance_count, 0, uploaded ? draw_count : 0);
+    }
+
+    end_rendering(command_buffer, p_target);
+
+    if (m_profiler != nullptr) {
+        m_profiler->end_region(command_buffer);
+
+        if (collect_statistics) {
+            m_profiler->end_statistics(command_buffer);
+        }
+
+        m_profiler->end_frame(command_buffer);
+    }
+
+    result = vkEndCommandBuffer(command_buffer);
+    if (result != VK_SUCCESS) {
+        throw generic_vulkan_exception_t{result, "Failed to stop recording the command buffer"};
+    }
+}
+
+auto renderer_t::record_draws(
+    VkCommandBuffer p_command_buffer,
+    VkPipeline p_pipeline,
+    const frame_descriptors_t& p_descriptors,
+    VkExtent2D p_extent,
+    const push_constants_t& p_push_constants,
+    uint32_t p_instance_count,
+    uint32_t p_first_draw,
+    uint32_t p_draw_count
+) const -> void {
+    // Secondary command buffers don't inherit any state, so all of this has to be set up
+    // again in every one of them.
+    vkCmdBindPipeline(p_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, p_pipeline);
+
+    const VkViewport viewport {
+        .x = 0,
+        .y = static_cast<float>(p_extent.height),
+        .width = static_cast<float>(p_extent.width),
+        .height = -static_cast<float>(p_extent.height),
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f,
+    };
+
+    vkCmdSetViewport(p_command_buffer, 0, 1, &viewport);
+
+    const VkRect2D scissor {
+        .offset = {
+            .x = 0,
+            .y = 0,
+        },
+        .extent = p_extent
+    };
+
+    vkCmdSetScissor(p_command_buffer, 0, 1, &scissor);
+
+    // Only the mesh, since the instances come out of the bindless table.
+    const VkDeviceSize offset = 0;
+    const VkBuffer vertex_buffer = m_vertex_buffer;
+    vkCmdBindVertexBuffers(p_command_buffer, 0, 1, &vertex_buffer, &offset);
+    vkCmdBindIndexBuffer(p_command_buffer, m_index_buffer, 0, VK_INDEX_TYPE_UINT32);
+
+    bind_descriptors(p_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout, *m_uniform_template, p_descriptors);
+
+    vkCmdPushConstants(p_command_buffer, m_pipeline_layout, VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(push_constants_t), &p_push_constants);
+
+    if (p_draw_count == 0) {
+        return;
+    }
+
+    if (m_culling != nullptr) {
+        vkCmdDrawIndexedIndirect(p_command_buffer, m_culling->draw_command_buffer, 0, 1, sizeof(VkDrawIndexedIndirectCommand));
+        return;
+    }
+
+    const auto index_count = static_cast<uint32_t>(m_mesh.indices.size());
+
+    for (uint32_t draw = p_first_draw; draw < p_first_draw + p_draw_count; draw++) {
+        const auto first_instance = draw * m_cubes_per_draw;
+        vkCmdDrawIndexed(p_command_buffer, index_count, std::min(m_cubes_per_draw, p_instance_count - first_instance), 0, 0, first_instance);
+    }
+}
+
+auto renderer_t::wait_until_ready() const -> void {
+    m_uploads.wait(m_mesh_upload);
+}
+
+auto renderer_t::reload_shaders() -> void {
+    // Only one rebuild at a time. Once it's done, it gets started over, so that the last
+    // change to the shaders is the one that ends up on screen.
+    if (m_pipeline_rebuild.valid()) {
+        m_rebuild_requested = true;
+        return;
+    }
+
+    // Everything that the thread touches outlives it, since the renderer waits for it
+    // before destroying anything. The pipeline cache is internally synchronized, so it's
+    // fine for it to be used from here.
+    //
+    // The states are copied out here, since record() may add new variants to the old
+    // pipelines while the thread is busy.
+    m_pipeline_rebuild = std::async(std::launch::async, [this, states = m_pipelines->get_states()]() {
+        auto pipelines = std::make_unique<pipeline_variants_t>(
+            m_device,
+            std::make_unique<shader_module_t>(m_device, shader_module_t::type_t::vertex, vertex_shader_path),
+            std::make_unique<shader_module_t>(m_device, shader_module_t::type_t::fragment, fragment_shader_path),
+            m_pipeline_layout,
+            get_pipeline_target(),
+            m_pipeline_cache
+        );
+
+        for (const auto& state : states) {
+            pipelines->get(state);
+        }
+
+        return pipelines;
+    });
+}
+
+auto renderer_t::swap_in_rebuilt_pipeline() -> void {
+    if (!m_pipeline_rebuild.valid() || m_pipeline_rebuild.wait_for(std::chrono::seconds{0}) != std::future_status::ready) {
+        return;
+    }
+
+    try {
+        auto pipelines = m_pipeline_rebuild.get();
+
+        // The frames that were already submitted keep using the old ones.
+        m_retired.defer(std::move(m_pipelines), m_submissions.get_last_submission(queue_kind_t::graphics));
+        m_pipelines = std::move(pipelines);
+
+        fmt::print(stderr, "[INFO]: Reloaded the shaders.\n");
+    } catch (const file_opening_exception_t& exception) {
+        fmt::print(stderr, fmt::fg(fmt::color::yellow), "[WARNING]: Failed to reload the shaders, couldn't open {}.\n", exception.file_name);
+    } catch (const vulkan_creation_exception_t& exception) {
+        fmt::print(
+            stderr,
+            fmt::fg(fmt::color::yellow),
+            "[WARNING]: Failed to reload the shaders, couldn't create a {}. Vulkan error {}.\n",
+            exception.object_name,
+            static_cast<int>(exception.error_code)
+        );
+    } catch (const generic_vulkan_exception_t& exception) {
+        fmt::print(
+            stderr,
+            fmt::fg(fmt::color::yellow),
+            "[WARNING]: Failed to reload the shaders: {} Vulkan error {}.\n",
+            exception.what,
+            static_cast<int>(exception.error_code)
+        );
+    } catch (const std::exception& exception) {
+        // Whatever else goes wrong (running out of memory, or failing to read a file that
+        // did open), the old pipelines are still good to keep drawing with.
+        fmt::print(stderr, fmt::fg(fmt::color::yellow), "[WARNING]: Failed to reload the shaders: {}\n", exception.what());
+    }
+
+    // Also after a failed rebuild, since the next change may well be the fix.
+    if (m_rebuild_requested) {
+        m_rebuild_requested = false;
+        reload_shaders();
+    }
+}
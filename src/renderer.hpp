@@ -0,0 +1,411 @@
+#pragma once
+
+#include <future>
+#include <memory>
+
+#include "common.hpp"
+#include "devices.hpp"
+#include "bindless.hpp"
+#include "buffers.hpp"
+#include "bvh.hpp"
+#include "commands.hpp"
+#include "deletion-queue.hpp"
+#include "descriptors.hpp"
+#include "frames.hpp"
+#include "memory.hpp"
+#include "meshes.hpp"
+#include "pipeline-variants.hpp"
+#include "pipelines.hpp"
+#include "profiler.hpp"
+#include "submissions.hpp"
+#include "transforms.hpp"
+#include "uniform-ring.hpp"
+#include "jobs.hpp"
+#include "uploads.hpp"
+
+namespace pooper_cube {
+    // Owns everything needed to draw the scene, independently of where it ends up being
+    // drawn to (a swap chain image or an offscreen image).
+    class renderer_t {
+        public:
+            // What moves the cubes, on top of the spin that the whole scene gets.
+            enum class animation_t {
+                // Nothing, the cubes stay however they were laid out.
+                none,
+
+                // Every cube spins around an axis of its own. The transforms are updated
+                // on the CPU and streamed into the instance buffer every frame.
+                cpu,
+
+                // The same spin, along with the one of the whole scene, worked out by a
+                // compute shader every frame. The instances never leave the GPU, and only
+                // the time gets sent over.
+                gpu,
+            };
+
+            struct settings_t {
+                uint32_t frames_in_flight;
+                uint32_t cube_count;
+
+                // Nests the cubes inside of each other instead of laying them out in a grid.
+                bool nested_cubes;
+
+                // Whether a compute shader should decide which cubes get drawn, instead of
+                // just drawing all of them.
+                bool gpu_culling;
+
+                // Whether the CPU should throw away the cubes outside of the view, by testing a
+                // BVH over them, so that only the ones that might be visible get drawn.
+                // Ignored with GPU culling.
+                bool cpu_culling;
+
+                // Splits the cubes up into draws of this many instances each. Zero draws them
+                // all at once.
+                uint32_t cubes_per_draw;
+
+                // How many pieces the draws get split up into. Anything above one records
+                // them into secondary command buffers, as jobs of their own.
+                uint32_t recording_threads;
+
+                animation_t animation;
+            };
+
+            struct push_constants_t {
+                glm::mat4 model;
+                float color_offset;
+
+                // Which storage buffer of the bindless table the vertex shader reads the
+                // instances out of.
+                uint32_t instance_buffer;
+
+                // Another storage buffer, with the index of the instance that each drawn
+                // instance stands for. Only used with CPU culling, and no_instance_indices
+                // otherwise, in which case the instances are read in order.
+                uint32_t instance_index_buffer;
+
+                static constexpr uint32_t no_instance_indices = std::numeric_limits<uint32_t>::max();
+            };
+
+            struct uniform_buffer_object_t {
+                glm::mat4 view;
+                glm::mat4 projection;
+                float color_offset;
+            };
+
+            // The buffers are indices into the storage buffers of the bindless table.
+            struct cull_push_constants_t {
+                glm::mat4 model;
+                uint32_t instance_count;
+                uint32_t instance_buffer;
+                uint32_t visible_instance_buffer;
+                uint32_t draw_command_buffer;
+            };
+
+            struct animate_push_constants_t {
+                float time;
+                uint32_t instance_count;
+                uint32_t rest_instance_buffer;
+                uint32_t animated_instance_buffer;
+            };
+
+            // Where a frame gets drawn to. Only the framebuffer is used with a render pass,
+            // and only the images and their views with dynamic rendering.
+            struct render_target_t {
+                VkFramebuffer framebuffer;
+
+                VkImage color_image;
+                VkImageView color_view;
+                VkImage depth_image;
+                VkImageView depth_view;
+
+                VkExtent2D extent;
+            };
+
+            renderer_t(
+                const physical_device_t& physical_device,
+                const device_t& device,
+                allocator_t& allocator,
+                submission_tracker_t& submissions,
+                upload_manager_t& uploads,
+                job_system_t& jobs,
+                const pipeline_cache_t& pipeline_cache,
+                VkFormat color_format,
+                VkImageLayout final_layout,
+                const settings_t& settings,
+                gpu_profiler_t* profiler
+            );
+
+            NO_COPY(renderer_t);
+
+            // Null when the device does dynamic rendering, in which case there's no need for
+            // framebuffers either.
+            auto get_render_pass() const noexcept -> const render_pass_t* { return m_render_pass.get(); }
+
+            auto get_frames() noexcept -> frame_ring_t& { return m_frames; }
+
+            // Records all the commands for drawing the scene at the given time into the
+            // command buffer of the frame. The frame must have already been reset. Until the
+            // mesh has finished uploading, this only clears the screen.
+            auto record(const frame_t& frame, const render_target_t& target, double time) -> void;
+
+            // Blocks until the mesh has been uploaded, after which every frame actually draws
+            // the scene.
+            auto wait_until_ready() const -> void;
+
+            // The upload that the submission of the last recorded frame has to wait on. Only
+            // the first frame that draws gets one, since every frame after it comes later on
+            // the graphics queue anyway. Seeing the upload complete on the CPU doesn't make
+            // the copies visible to another queue.
+            auto get_upload_wait() const noexcept -> std::optional<upload_ticket_t> { return m_upload_wait; }
+
+            // Starts building new graphics pipelines out of the shaders on disk, on a thread
+            // of its own, for every variant that has been used so far. Rendering carries on
+            // with the old pipelines until the new ones are done, at which point the next
+            // record() switches over to them. If the shaders don't compile, the old pipelines
+            // are simply kept.
+            auto reload_shaders() -> void;
+
+            // How long the last record() spent updating the transforms, in milliseconds.
+            // Empty unless the cubes are animated on the CPU.
+            auto get_transform_update_time() const noexcept -> std::optional<double> { return m_transform_update_time; }
+
+            // How long the last record() spent culling on the CPU, in milliseconds. Empty
+            // unless culling on the CPU.
+            auto get_cpu_culling_time() const noexcept -> std::optional<double> { return m_cpu_culling_time; }
+
+        private:
+            // Plenty of room for per-draw constants, should anything ever need them.
+            static constexpr VkDeviceSize uniform_ring_frame_size = 64 * 1024;
+
+            // The largest minStorageBufferOffsetAlignment that the spec allows, so that every
+            // frame's copy of the instances can be bound as a storage buffer of its own.
+            static constexpr VkDeviceSize instance_region_alignment = 256;
+
+            // How set 0 gets bound for a frame. Without push descriptors, every frame binds the
+            // same set, with the offset of the buffer as its dynamic offset. With them, the
+            // set is null, and the buffer gets pushed into the command buffer instead.
+            struct frame_descriptors_t {
+                VkDescriptorSet uniform_set;
+                VkDescriptorBufferInfo uniform_buffer;
+            };
+
+            // Everything that is only needed for GPU culling.
+            struct culling_t {
+                culling_t(
+                    allocator_t& allocator,
+                    const pipeline_cache_t& pipeline_cache,
+                    const descriptor_layout_t& uniform_layout,
+                    const descriptor_layout_t& bindless_layout,
+                    VkDeviceSize instance_buffer_size
+                );
+
+                NO_COPY(culling_t);
+
+                shader_module_t compute_shader;
+                pipeline_layout_t pipeline_layout;
+                compute_pipeline_t pipeline;
+
+                // Null without push descriptors. The graphics one can't be used for this,
+                // since the pipeline layouts aren't compatible.
+                std::unique_ptr<descriptor_update_template_t> uniform_template;
+
+                // The instances that survived culling, packed together.
+                buffer_t visible_instance_buffer;
+
+                // A single VkDrawIndexedIndirectCommand, whose instance count is filled in
+                // by the shader.
+                buffer_t draw_command_buffer;
+
+                // Where the buffers ended up in the bindless table.
+                uint32_t visible_instance_buffer_index;
+                uint32_t draw_command_buffer_index;
+            };
+
+            // Everything that is only needed for animating the instances on the GPU.
+            struct gpu_animation_t {
+                gpu_animation_t(
+                    allocator_t& allocator,
+                    const pipeline_cache_t& pipeline_cache,
+                    const descriptor_layout_t& uniform_layout,
+                    const descriptor_layout_t& bindless_layout,
+                    VkDeviceSize instance_buffer_size
+                );
+
+                NO_COPY(gpu_animation_t);
+
+                shader_module_t compute_shader;
+                pipeline_layout_t pipeline_layout;
+                compute_pipeline_t pipeline;
+
+                // Where the instances are at the current time. Written from scratch every
+                // frame, out of the instance buffer, which holds where they started.
+                buffer_t animated_instance_buffer;
+                uint32_t animated_instance_buffer_index;
+            };
+
+            // Everything that is only needed for CPU culling.
+            struct cpu_culling_t {
+                cpu_culling_t(
+                    allocator_t& allocator,
+                    std::span<const instance_data_t> instances,
+                    bool loose_bounds,
+                    uint32_t frame_count,
+                    job_system_t& jobs
+                );
+
+                NO_COPY(cpu_culling_t);
+
+                instance_bvh_t bvh;
+
+                // The indices of the instances that survived the last cull. Kept around, so
+                // that it doesn't have to be allocated again every frame.
+                std::vector<uint32_t> visible_instances;
+
+                // Where the indices get copied to, with a region for every frame in flight,
+                // each with room for every instance. Stays mapped.
+                VkDeviceSize region_size;
+                host_coherent_buffer_t visible_index_buffer;
+                std::byte* mapped_visible_indices;
+
+                // Where each region ended up in the bindless table.
+                std::vector<uint32_t> visible_index_buffer_indices;
+            };
+
+            auto record_culling(VkCommandBuffer command_buffer, uint32_t instance_buffer, const frame_descriptors_t& descriptors, const glm::mat4& model) const -> void;
+            auto record_animation(VkCommandBuffer command_buffer, double time) const -> void;
+
+            // Which copy of the instances the frame draws from. There's only one of them
+            // unless the cubes are animated on the CPU.
+            auto get_instance_region(uint32_t frame_index) const noexcept -> uint32_t;
+
+            // The storage buffer that holds the frame's instances before culling, as an index
+            // into the bindless table.
+            auto get_instance_buffer_index(uint32_t frame_index) const noexcept -> uint32_t;
+
+            // Binds set 0 and the bindless table. The template is only used with push
+            // descriptors, and has to have been made for the bind point and pipeline layout.
+            auto bind_descriptors(
+                VkCommandBuffer command_buffer,
+                VkPipelineBindPoint bind_point,
+                VkPipelineLayout pipeline_layout,
+                const descriptor_update_template_t& push_template,
+                const frame_descriptors_t& descriptors
+            ) const -> void;
+
+            // Starts and ends either the render pass or dynamic rendering. Without a render
+            // pass, the layout transitions that it would have done are recorded by hand.
+            auto begin_rendering(VkCommandBuffer command_buffer, const render_target_t& target, bool secondary_command_buffers) const -> void;
+            auto end_rendering(VkCommandBuffer command_buffer, const render_target_t& target) const -> void;
+
+            auto get_pipeline_target() const noexcept -> pipeline_target_t;
+
+            // Sets up all the state for drawing and records the given range of draws. Works
+            // for both primary and secondary command buffers.
+            auto record_draws(
+                VkCommandBuffer command_buffer,
+                VkPipeline pipeline,
+                const frame_descriptors_t& descriptors,
+                VkExtent2D extent,
+                const push_constants_t& push_constants,
+                uint32_t instance_count,
+                uint32_t first_draw,
+                uint32_t draw_count
+            ) const -> void;
+
+            // Switches over to the rebuilt graphics pipelines, if they're done.
+            auto swap_in_rebuilt_pipeline() -> void;
+
+            const device_t& m_device;
+            submission_tracker_t& m_submissions;
+            upload_manager_t& m_uploads;
+            job_system_t& m_jobs;
+            const pipeline_cache_t& m_pipeline_cache;
+
+            // Null unless profiling is enabled.
+            gpu_profiler_t* m_profiler;
+
+            command_pool_t m_command_pool;
+
+            // Set 1 of every pipeline.
+            bindless_table_t m_bindless;
+
+            // Set 0 of every pipeline, which only holds the uniforms. A push descriptor
+            // set if the device can do that, and a dynamic uniform buffer otherwise.
+            descriptor_layout_t m_descriptor_layout;
+
+            // Null with push descriptors. Otherwise, the only set 0 there is, which every
+            // frame binds with its own dynamic offset.
+            std::unique_ptr<descriptor_allocator_t> m_descriptor_allocator;
+            VkDescriptorSet m_uniform_set;
+
+            pipeline_layout_t m_pipeline_layout;
+
+            // Pushes set 0 for the graphics pipelines, or writes the one set 0 otherwise.
+            std::unique_ptr<descriptor_update_template_t> m_uniform_template;
+
+            VkFormat m_color_format;
+            VkFormat m_depth_format;
+            VkImageLayout m_final_layout;
+
+            // Null with dynamic rendering.
+            std::unique_ptr<render_pass_t> m_render_pass;
+            std::unique_ptr<pipeline_variants_t> m_pipelines;
+
+            // What the cubes get drawn with. Picked once, up front.
+            graphics_pipeline_state_t m_pipeline_state;
+
+            mesh_t m_mesh;
+            buffer_t m_vertex_buffer;
+            buffer_t m_index_buffer;
+
+            std::vector<instance_data_t> m_instances;
+
+            // Device local and uploaded once, unless the cubes are animated on the CPU. Then
+            // it's host visible instead, and stays mapped, with a copy of the instances for
+            // every frame in flight, each in a region of its own.
+            VkDeviceSize m_instance_region_size;
+            std::unique_ptr<buffer_t> m_instance_buffer;
+            std::byte* m_mapped_instances;
+
+            // Where each region ended up in the bindless table.
+            std::vector<uint32_t> m_instance_buffer_indices;
+
+            // Null unless the cubes are animated on the CPU.
+            std::unique_ptr<transform_store_t> m_transforms;
+            std::optional<double> m_last_time;
+            std::optional<double> m_transform_update_time;
+
+            upload_ticket_t m_mesh_upload;
+            std::optional<upload_ticket_t> m_upload_wait;
+            bool m_mesh_upload_waited_on;
+
+            uint32_t m_cubes_per_draw;
+
+            // With CPU culling, this is worked out again every frame from the cubes that
+            // survived.
+            uint32_t m_draw_count;
+
+            // Null if GPU culling is disabled.
+            std::unique_ptr<culling_t> m_culling;
+
+            // Null unless the cubes are animated on the GPU.
+            std::unique_ptr<gpu_animation_t> m_gpu_animation;
+
+            // Null unless culling on the CPU.
+            std::unique_ptr<cpu_culling_t> m_cpu_culling;
+            std::optional<double> m_cpu_culling_time;
+
+            uniform_ring_t m_uniforms;
+
+            frame_ring_t m_frames;
+
+            // Pipeline variants that were replaced, but that frames in flight may still be using.
+            deletion_queue_t m_retired;
+
+            // Last, so that the rebuild is finished before anything that it uses goes away.
+            std::future<std::unique_ptr<pipeline_variants_t>> m_pipeline_rebuild;
+
+            // Set when the shaders changed again while a rebuild was already underway.
+            bool m_rebuild_requested;
+    };
+}
@@ -0,0 +1,159 @@
+#include "submissions.hpp"
+
+using pooper_cube::submission_tracker_t;
+using pooper_cube::submission_t;
+using pooper_cube::semaphore_wait_t;
+
+submission_tracker_t::submission_tracker_t(const device_t& p_device) : m_device(p_device), m_next_value(1) {
+    const std::array<VkQueue, queue_count> queues {
+        m_device.get_graphics_queue(),
+        m_device.get_compute_queue(),
+        m_device.get_transfer_queue(),
+    };
+
+    for (size_t i = 0; i < queue_count; i++) {
+        m_queues[i].queue = queues[i];
+        m_queues[i].semaphore = std::make_unique<timeline_semaphore_t>(m_device);
+        m_queues[i].last_submitted = 0;
+        m_queues[i].last_retired = 0;
+    }
+}
+
+auto submission_tracker_t::submit(
+    queue_kind_t p_queue,
+    std::span<const VkCommandBuffer> p_command_buffers,
+    std::span<const semaphore_wait_t> p_waits,
+    std::span<const VkSemaphore> p_binary_signals
+) -> submission_t {
+    std::vector<VkSemaphore> wait_semaphores;
+    std::vector<uint64_t> wait_values;
+    std::vector<VkPipelineStageFlags> wait_stages;
+
+    wait_semaphores.reserve(p_waits.size());
+    wait_values.reserve(p_waits.size());
+    wait_stages.reserve(p_waits.size());
+
+    for (const auto& wait : p_waits) {
+        wait_semaphores.push_back(wait.semaphore);
+        wait_values.push_back(wait.value);
+        wait_stages.push_back(wait.stage);
+    }
+
+    const std::lock_guard lock{m_mutex};
+    auto& state = get_state(p_queue);
+    const auto value = m_next_value;
+
+    // The timeline semaphore goes first, the binary ones follow it. The values of the
+    // binary semaphores are ignored, but there still has to be one for every semaphore.
+    std::vector<VkSemaphore> signal_semaphores{*state.semaphore};
+    std::vector<uint64_t> signal_values{value};
+
+    signal_semaphores.insert(signal_semaphores.end(), p_binary_signals.begin(), p_binary_signals.end());
+    signal_values.resize(signal_semaphores.size(), 0);
+
+    const VkTimelineSemaphoreSubmitInfo timeline_info {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .pNext = nullptr,
+        .waitSemaphoreValueCount = static_cast<uint32_t>(wait_values.size()),
+        .pWaitSemaphoreValues = wait_values.data(),
+        .signalSemaphoreValueCount = static_cast<uint32_t>(signal_values.size()),
+        .pSignalSemaphoreValues = signal_values.data(),
+    };
+
+    const VkSubmitInfo submit_info {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = &timeline_info,
+        .waitSemaphoreCount = static_cast<uint32_t>(wait_semaphores.size()),
+        .pWaitSemaphores = wait_semaphores.data(),
+        .pWaitDstStageMask = wait_stages.data(),
+        .commandBufferCount = static_cast<uint32_t>(p_command_buffers.size()),
+        .pCommandBuffers = p_command_buffers.data(),
+        .signalSemaphoreCount = static_cast<uint32_t>(signal_semaphores.size()),
+        .pSignalSemaphores = signal_semaphores.data(),
+    };
+
+    const auto result = vkQueueSubmit(state.queue, 1, &submit_info, VK_NULL_HANDLE);
+    if (result != VK_SUCCESS) {
+        throw generic_vulkan_exception_t{result, "Failed to submit to a queue."};
+    }
+
+    // Only used up once the submission actually made it, so that a failed one can't leave
+    // a value behind that never gets signaled.
+    m_next_value++;
+    state.last_submitted = value;
+
+    return submission_t{p_queue, value};
+}
+
+auto submission_tracker_t::is_retired(submission_t p_submission) -> bool {
+    auto& state = get_state(p_submission.queue);
+
+    if (p_submission.value <= state.last_retired.load(std::memory_order_acquire)) {
+        return true;
+    }
+
+    const auto value = state.semaphore->get_value();
+    mark_retired(state, value);
+
+    return p_submission.value <= value;
+}
+
+auto submission_tracker_t::wait(submission_t p_submission) -> void {
+    auto& state = get_state(p_submission.queue);
+
+    if (p_submission.value <= state.last_retired.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    state.semaphore->wait(p_submission.value);
+    mark_retired(state, p_submission.value);
+}
+
+auto submission_tracker_t::get_last_submission(queue_kind_t p_queue) -> submission_t {
+    const std::lock_guard lock{m_mutex};
+    return submission_t{p_queue, get_state(p_queue).last_submitted};
+}
+
+auto submission_tracker_t::get_wait(submission_t p_submission, VkPipelineStageFlags p_stage) const noexcept -> semaphore_wait_t {
+    return semaphore_wait_t{*get_state(p_submission.queue).semaphore, p_submission.value, p_stage};
+}
+
+auto submission_tracker_t::wait_idle() -> void {
+    std::array<uint64_t, queue_count> last_submitted;
+
+    {
+        const std::lock_guard lock{m_mutex};
+        for (size_t i = 0; i < queue_count; i++) {
+            last_submitted[i] = m_queues[i].last_submitted;
+        }
+    }
+
+    for (size_t i = 0; i < queue_count; i++) {
+        wait(submission_t{static_cast<queue_kind_t>(i), last_submitted[i]});
+    }
+}
+
+auto submission_tracker_t::mark_retired(queue_state_t& p_state, uint64_t p_value) noexcept -> void {
+    // Another thread may have found out about a later value in the meantime, and we don't
+    // want to go backwards.
+    auto last_retired = p_state.last_retired.load(std::memory_order_relaxed);
+    while (last_retired < p_value && !p_state.last_retired.compare_exchange_weak(last_retired, p_value, std::memory_order_release, std::memory_order_relaxed)) {}
+}
+
+submission_tracker_t::~submission_tracker_t() noexcept {
+    // The semaphores can't go away while a submission is still going to signal them.
+    for (const auto& state : m_queues) {
+        const VkSemaphore semaphore = *state.semaphore;
+
+        const VkSemaphoreWaitInfo wait_info {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .semaphoreCount = 1,
+            .pSemaphores = &semaphore,
+            .pValues = &state.last_submitted,
+        };
+
+        vkWaitSemaphores(m_device, &wait_info, std::numeric_limits<uint64_t>::max());
+    }
+}
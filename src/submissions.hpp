@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "common.hpp"
+#include "devices.hpp"
+#include "sync-objects.hpp"
+
+namespace pooper_cube {
+    enum class queue_kind_t {
+        graphics,
+        compute,
+        transfer,
+    };
+
+    // Identifies a single submission to one of the queues. A value of zero stands for
+    // "nothing", which has always retired.
+    struct submission_t {
+        queue_kind_t queue;
+        uint64_t value;
+    };
+
+    // Something that a submission has to wait for before it can get to the given stage.
+    // Binary semaphores ignore the value.
+    struct semaphore_wait_t {
+        VkSemaphore semaphore;
+        uint64_t value;
+        VkPipelineStageFlags stage;
+    };
+
+    // Sends everything off to the queues, and keeps track of what the GPU has gotten
+    // through. Every queue gets a timeline semaphore that each submission sets to a value of
+    // its own, so finding out whether a submission has retired is as simple as looking at a
+    // counter, without a fence per submission.
+    //
+    // The values are handed out from a single counter shared by all of the queues, which
+    // means that they only ever go up, on every queue. Since different kinds of queue may
+    // well be the same VkQueue, all submissions must go through here, which also takes care
+    // of synchronizing access to the queues (presenting aside).
+    class submission_tracker_t {
+        public:
+            submission_tracker_t(const device_t& device);
+            NO_COPY(submission_tracker_t);
+
+            // The command buffers run after all of the waits, and the binary semaphores get
+            // signaled along with the queue's timeline semaphore once they're done.
+            auto submit(
+                queue_kind_t queue,
+                std::span<const VkCommandBuffer> command_buffers,
+                std::span<const semaphore_wait_t> waits = {},
+                std::span<const VkSemaphore> binary_signals = {}
+            ) -> submission_t;
+
+            // Doesn't block. Safe to call from any thread.
+            auto is_retired(submission_t submission) -> bool;
+
+            // Blocks until the submission has retired. Safe to call from any thread.
+            auto wait(submission_t submission) -> void;
+
+            // The most recent submission to the queue, or nothing if there hasn't been one.
+            auto get_last_submission(queue_kind_t queue) -> submission_t;
+
+            // Lets a submission on one queue wait for a submission on another one, without
+            // the CPU getting involved.
+            auto get_wait(submission_t submission, VkPipelineStageFlags stage) const noexcept -> semaphore_wait_t;
+
+            // Blocks until everything that has been submitted so far has retired.
+            auto wait_idle() -> void;
+
+            ~submission_tracker_t() noexcept;
+
+        private:
+            static constexpr size_t queue_count = 3;
+
+            struct queue_state_t {
+                VkQueue queue;
+                std::unique_ptr<timeline_semaphore_t> semaphore;
+
+                // The last value submitted to the queue. Only touched with the mutex held.
+                uint64_t last_submitted;
+
+                // The last value that we know the GPU got to, so that we don't have to ask
+                // the driver about things that are long done.
+                std::atomic<uint64_t> last_retired;
+            };
+
+            auto get_state(queue_kind_t queue) noexcept -> queue_state_t& { return m_queues[static_cast<size_t>(queue)]; }
+            auto get_state(queue_kind_t queue) const noexcept -> const queue_state_t& { return m_queues[static_cast<size_t>(queue)]; }
+
+            // Remembers that the queue got at least this far.
+            static auto mark_retired(queue_state_t& state, uint64_t value) noexcept -> void;
+
+            const device_t& m_device;
+
+            // Held across vkQueueSubmit, so that values reach each queue in order.
+            std::mutex m_mutex;
+
+            std::array<queue_state_t, queue_count> m_queues;
+            uint64_t m_next_value;
+    };
+}
@@ -8,7 +8,48 @@
 
 using pooper_cube::swapchain_t;
 
-swapchain_t::swapchain_t(const window_t& p_window, const physical_device_t& p_physical_device, const device_t& p_device, const window_t::surface_t& p_surface) : m_device(p_device) {
+namespace {
+    struct present_mode_name_t {
+        VkPresentModeKHR present_mode;
+        std::string_view name;
+    };
+
+    constexpr std::array<present_mode_name_t, 4> present_mode_names {
+        present_mode_name_t{VK_PRESENT_MODE_IMMEDIATE_KHR, "immediate"},
+        present_mode_name_t{VK_PRESENT_MODE_MAILBOX_KHR, "mailbox"},
+        present_mode_name_t{VK_PRESENT_MODE_FIFO_KHR, "fifo"},
+        present_mode_name_t{VK_PRESENT_MODE_FIFO_RELAXED_KHR, "fifo-relaxed"},
+    };
+}
+
+auto pooper_cube::get_present_mode_name(VkPresentModeKHR p_present_mode) -> std::string_view {
+    for (const auto& entry : present_mode_names) {
+        if (entry.present_mode == p_present_mode) {
+            return entry.name;
+        }
+    }
+
+    return "unknown";
+}
+
+auto pooper_cube::parse_present_mode(std::string_view p_name) -> std::optional<VkPresentModeKHR> {
+    for (const auto& entry : present_mode_names) {
+        if (entry.name == p_name) {
+            return entry.present_mode;
+        }
+    }
+
+    return std::optional<VkPresentModeKHR>{};
+}
+
+swapchain_t::swapchain_t(
+    const window_t& p_window,
+    const physical_device_t& p_physical_device,
+    const device_t& p_device,
+    const window_t::surface_t& p_surface,
+    const swapchain_settings_t& p_settings,
+    VkSwapchainKHR p_old_swapchain
+) : m_device(p_device) {
     VkSurfaceCapabilitiesKHR surface_capabilities;
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(p_physical_device, p_surface, &surface_capabilities);
 
@@ -25,14 +66,14 @@ swapchain_t::swapchain_t(const window_t& p_window, const physical_device_t& p_ph
 
         m_extent.width = std::clamp(
             static_cast<uint32_t>(framebuffer_width), 
-            surface_capabilities.maxImageExtent.width,
-            surface_capabilities.minImageExtent.width
+            surface_capabilities.minImageExtent.width,
+            surface_capabilities.maxImageExtent.width
         );
 
         m_extent.height = std::clamp(
             static_cast<uint32_t>(framebuffer_height), 
-            surface_capabilities.maxImageExtent.height,
-            surface_capabilities.minImageExtent.height
+            surface_capabilities.minImageExtent.height,
+            surface_capabilities.maxImageExtent.height
         );
     }
 
@@ -57,21 +98,53 @@ swapchain_t::swapchain_t(const window_t& p_window, const physical_device_t& p_ph
     uint32_t present_mode_count;
     vkGetPhysicalDeviceSurfacePresentModesKHR(p_physical_device, p_surface, &present_mode_count, nullptr);
 
-    std::vector<VkPresentModeKHR> present_modes;
+    std::vector<VkPresentModeKHR> present_modes(present_mode_count);
     vkGetPhysicalDeviceSurfacePresentModesKHR(p_physical_device, p_surface, &present_mode_count, present_modes.data());
 
+    const auto is_supported = [&](VkPresentModeKHR p_present_mode) {
+        return std::find(present_modes.begin(), present_modes.end(), p_present_mode) != present_modes.end();
+    };
+
     // Only VK_PRESENT_MODE_FIFO_KHR is guaranteed to be available.
     // According to https://vulkan-tutorial.com/Drawing_a_triangle/Presentation/Swap_chain,
     // that is
-    VkPresentModeKHR chosen_present_mode{VK_PRESENT_MODE_FIFO_KHR};
-    for (const auto& present_mode : present_modes) {
+    m_present_mode = VK_PRESENT_MODE_FIFO_KHR;
+
+    if (p_settings.present_mode.has_value()) {
+        if (is_supported(p_settings.present_mode.value())) {
+            m_present_mode = p_settings.present_mode.value();
+        } else if (p_old_swapchain == VK_NULL_HANDLE) {
+            // Only complained about once, not every time that the window gets resized.
+            fmt::print(
+                stderr,
+                fmt::fg(fmt::color::yellow),
+                "[WARNING]: The {} present mode isn't supported, falling back to fifo.\n",
+                get_present_mode_name(p_settings.present_mode.value())
+            );
+        }
+    } else if (is_supported(VK_PRESENT_MODE_MAILBOX_KHR)) {
         // I prefer to use mailbox, mainly because it allows me to get rid of 
         // screen tearing while also maintaining a decent amount of latency.
         // You can read more here:
         // https://registry.khronos.org/vulkan/specs/1.3-extensions/html/chap34.html#VkPresentModeKHR
-        if (present_mode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            chosen_present_mode = present_mode;
-        }
+        m_present_mode = VK_PRESENT_MODE_MAILBOX_KHR;
+    }
+
+    // A maximum of zero means that there is no maximum.
+    const auto max_image_count = surface_capabilities.maxImageCount == 0
+        ? std::numeric_limits<uint32_t>::max()
+        : surface_capabilities.maxImageCount;
+
+    const auto requested_image_count = p_settings.image_count.value_or(surface_capabilities.minImageCount + 1);
+    const auto min_image_count = std::clamp(requested_image_count, surface_capabilities.minImageCount, max_image_count);
+
+    if (p_settings.image_count.has_value() && min_image_count != requested_image_count && p_old_swapchain == VK_NULL_HANDLE) {
+        fmt::print(
+            stderr,
+            fmt::fg(fmt::color::yellow),
+            "[WARNING]: The swap chain can't have {} images, using {} instead.\n",
+            requested_image_count, min_image_count
+        );
     }
 
     VkSwapchainCreateInfoKHR swapchain_info {
@@ -79,7 +152,8 @@ swapchain_t::swapchain_t(const window_t& p_window, const physical_device_t& p_ph
         .pNext = nullptr,
         .flags = 0,
         .surface = p_surface,
-        .minImageCount = std::min(surface_capabilities.minImageCount + 1, surface_capabilities.maxImageCount),
+        // The driver is allowed to create more than this, but never fewer.
+        .minImageCount = min_image_count,
         .imageFormat = chosen_surface_format.format,
         .imageColorSpace = chosen_surface_format.colorSpace,
         .imageExtent = m_extent,
@@ -94,9 +168,9 @@ swapchain_t::swapchain_t(const window_t& p_window, const physical_device_t& p_ph
 
         .preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR,
         .compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
-        .presentMode = chosen_present_mode,
+        .presentMode = m_present_mode,
         .clipped = VK_TRUE,
-        .oldSwapchain = VK_NULL_HANDLE,
+        .oldSwapchain = p_old_swapchain,
     };
 
     const uint32_t queue_families[] = {
@@ -179,6 +253,8 @@ auto swapchain_t::operator=(swapchain_t&& other) -> swapchain_t& {
     m_image_views = std::move(other.m_image_views);
     m_images = std::move(other.m_images);
     m_extent = other.m_extent;
+    m_format = other.m_format;
+    m_present_mode = other.m_present_mode;
 
     other.m_swapchain = VK_NULL_HANDLE;
     other.m_images = {};
@@ -194,13 +270,21 @@ namespace pooper_cube {
         const swapchain_t& p_swapchain, 
         const image_t& p_depth_buffer,
         const render_pass_t& p_render_pass
+    ) : framebuffers_t(p_device, p_swapchain.get_image_views(), p_swapchain.get_extent(), p_depth_buffer, p_render_pass)
+    {}
+
+    framebuffers_t::framebuffers_t(
+        const device_t& p_device, 
+        std::span<const VkImageView> p_color_views, 
+        VkExtent2D p_extent, 
+        const image_t& p_depth_buffer,
+        const render_pass_t& p_render_pass
     ) : m_device(p_device)
     {
-        const auto& image_views = p_swapchain.get_image_views();
-        const auto extent = p_swapchain.get_extent();
-        m_framebuffers.reserve(image_views.size()); // Reserve the space for all the framebuffers.
+        const auto extent = p_extent;
+        m_framebuffers.reserve(p_color_views.size()); // Reserve the space for all the framebuffers.
 
-        for (auto image_view : image_views) {
+        for (auto image_view : p_color_views) {
             const std::array<VkImageView, 2> attachments { image_view, p_depth_buffer.get_view() };
 
             const VkFramebufferCreateInfo framebuffer_info {
@@ -8,6 +8,21 @@ namespace pooper_cube {
     class render_pass_t;
     class image_t;
 
+    struct swapchain_settings_t {
+        // Falls back to FIFO (which is always there) if the surface doesn't support it.
+        // Without one, mailbox is used if it's there, and FIFO otherwise.
+        std::optional<VkPresentModeKHR> present_mode;
+
+        // Clamped to whatever the surface allows. Without one, it's one more than the
+        // minimum, so that there's always an image to render into while the others are
+        // waiting to be presented.
+        std::optional<uint32_t> image_count;
+    };
+
+    // The name that the command line uses, such as "fifo-relaxed".
+    auto get_present_mode_name(VkPresentModeKHR p_present_mode) -> std::string_view;
+    auto parse_present_mode(std::string_view p_name) -> std::optional<VkPresentModeKHR>;
+
     class swapchain_t {
         public:
             swapchain_t(const device_t& device) : 
@@ -15,14 +30,21 @@ namespace pooper_cube {
                 m_images{},
                 m_image_views{},
                 m_extent{},
+                m_format(VK_FORMAT_UNDEFINED),
+                m_present_mode(VK_PRESENT_MODE_FIFO_KHR),
                 m_device(device)
             {}
 
+            // Passing the swap chain that is being replaced lets the driver hand its resources
+            // over to the new one. The old one is retired by this, but it still has to be
+            // destroyed, and not before the GPU is done with it.
             explicit swapchain_t(
                 const window_t& window, 
                 const physical_device_t& physical_device, 
                 const device_t& device, 
-                const window_t::surface_t& surface
+                const window_t::surface_t& surface,
+                const swapchain_settings_t& settings,
+                VkSwapchainKHR old_swapchain = VK_NULL_HANDLE
             );
 
             swapchain_t(const swapchain_t&) = delete;
@@ -52,6 +74,14 @@ namespace pooper_cube {
                 return m_format;
             }
 
+            auto get_present_mode() const noexcept -> VkPresentModeKHR {
+                return m_present_mode;
+            }
+
+            auto get_image_count() const noexcept -> uint32_t {
+                return static_cast<uint32_t>(m_images.size());
+            }
+
             ~swapchain_t() noexcept {
                 std::for_each(m_image_views.cbegin(), m_image_views.cend(), [this](auto view) { vkDestroyImageView(m_device, view, nullptr); });
                 vkDestroySwapchainKHR(m_device, m_swapchain, nullptr);
@@ -65,6 +95,7 @@ namespace pooper_cube {
 
             VkExtent2D m_extent;
             VkFormat m_format;
+            VkPresentModeKHR m_present_mode;
 
             const device_t& m_device;
     };
@@ -74,6 +105,16 @@ namespace pooper_cube {
             framebuffers_t(const device_t& device) : m_framebuffers{}, m_device(device) {}
 
             framebuffers_t(const device_t& device, const swapchain_t& swapchain, const image_t& depth_buffer, const render_pass_t& render_pass);
+
+            // Creates one framebuffer for each of the color attachments, all of which share
+            // the same depth buffer. Used for rendering without a swap chain.
+            framebuffers_t(
+                const device_t& device, 
+                std::span<const VkImageView> color_views, 
+                VkExtent2D extent, 
+                const image_t& depth_buffer, 
+                const render_pass_t& render_pass
+            );
             NO_COPY(framebuffers_t);
 
             auto operator=(framebuffers_t&& other) -> const framebuffers_t& {
@@ -86,6 +127,10 @@ namespace pooper_cube {
                 return m_framebuffers.at(index);
             }
 
+            auto is_empty() const noexcept -> bool {
+                return m_framebuffers.empty();
+            }
+
             ~framebuffers_t() {
                 for (const auto framebuffer : m_framebuffers) {
                     vkDestroyFramebuffer(m_device, framebuffer, nullptr);
@@ -1,6 +1,7 @@
 #include "sync-objects.hpp"
 
 using pooper_cube::semaphore_t;
+using pooper_cube::timeline_semaphore_t;
 using pooper_cube::fence_t;
 
 semaphore_t::semaphore_t(const device_t& p_device) : m_device(p_device) {
@@ -16,6 +17,73 @@ semaphore_t::semaphore_t(const device_t& p_device) : m_device(p_device) {
     }
 }
 
+timeline_semaphore_t::timeline_semaphore_t(const device_t& p_device, uint64_t p_initial_value) : m_device(p_device) {
+    const VkSemaphoreTypeCreateInfo type_info {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .pNext = nullptr,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = p_initial_value,
+    };
+
+    const VkSemaphoreCreateInfo semaphore_info {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &type_info,
+        .flags = 0,
+    };
+
+    const auto result = vkCreateSemaphore(m_device, &semaphore_info, nullptr, &m_handle);
+    if (result != VK_SUCCESS) {
+        throw vulkan_creation_exception_t{result, "timeline semaphore"};
+    }
+}
+
+auto timeline_semaphore_t::get_value() const -> uint64_t {
+    uint64_t value;
+
+    const auto result = vkGetSemaphoreCounterValue(m_device, m_handle, &value);
+    if (result != VK_SUCCESS) {
+        throw generic_vulkan_exception_t{result, "Failed to get the value of a timeline semaphore."};
+    }
+
+    return value;
+}
+
+auto timeline_semaphore_t::wait(uint64_t p_value, uint64_t p_timeout) const -> bool {
+    const VkSemaphoreWaitInfo wait_info {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .semaphoreCount = 1,
+        .pSemaphores = &m_handle,
+        .pValues = &p_value,
+    };
+
+    const auto result = vkWaitSemaphores(m_device, &wait_info, p_timeout);
+    if (result == VK_TIMEOUT) {
+        return false;
+    }
+
+    if (result != VK_SUCCESS) {
+        throw generic_vulkan_exception_t{result, "Failed to wait for a timeline semaphore."};
+    }
+
+    return true;
+}
+
+auto timeline_semaphore_t::signal(uint64_t p_value) const -> void {
+    const VkSemaphoreSignalInfo signal_info {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO,
+        .pNext = nullptr,
+        .semaphore = m_handle,
+        .value = p_value,
+    };
+
+    const auto result = vkSignalSemaphore(m_device, &signal_info);
+    if (result != VK_SUCCESS) {
+        throw generic_vulkan_exception_t{result, "Failed to signal a timeline semaphore."};
+    }
+}
+
 fence_t::fence_t(const device_t& p_device) : m_device(p_device) {
     const VkFenceCreateInfo fence_info {
         .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
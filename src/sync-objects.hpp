@@ -20,6 +20,36 @@ namespace pooper_cube {
             const device_t& m_device;
     };
 
+    // A semaphore that counts up instead of flipping between signaled and unsignaled. The
+    // GPU (or the CPU) sets it to a value when it gets to some point, and anyone can wait
+    // for it to reach a value or simply check how far it has gotten, which is a lot cheaper
+    // than keeping a fence around for every submission.
+    class timeline_semaphore_t {
+        public:
+            timeline_semaphore_t(const device_t& device, uint64_t initial_value = 0);
+            NO_COPY(timeline_semaphore_t);
+
+            operator VkSemaphore() const noexcept { return m_handle; }
+
+            auto get_value() const -> uint64_t;
+
+            // Returns false if the timeout ran out before the value was reached. The timeout
+            // is in nanoseconds.
+            auto wait(uint64_t value, uint64_t timeout = std::numeric_limits<uint64_t>::max()) const -> bool;
+
+            // Sets the value from the CPU. It must be larger than the current value, and
+            // larger than any value that a pending submission is going to set it to.
+            auto signal(uint64_t value) const -> void;
+
+            ~timeline_semaphore_t() noexcept {
+                vkDestroySemaphore(m_device, m_handle, nullptr);
+            }
+
+        private:
+            VkSemaphore m_handle;
+            const device_t& m_device;
+    };
+
     class fence_t {
         public:
             fence_t(const device_t& device);
@@ -0,0 +1,411 @@
+#if defined(__x86_64__) || defined(_M_X64)
+#define HAS_AVX2_KERNEL
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#include "transforms.hpp"
+
+using pooper_cube::instance_data_t;
+using pooper_cube::transform_store_t;
+
+namespace {
+    // Pointers to the start of every array, so that the kernels don't have to know about
+    // the store.
+    struct transform_arrays_t {
+        float* position_x;
+        float* position_y;
+        float* position_z;
+        float* rotation_x;
+        float* rotation_y;
+        float* rotation_z;
+        float* rotation_w;
+        const float* scale_x;
+        const float* scale_y;
+        const float* scale_z;
+        const float* angular_velocity_x;
+        const float* angular_velocity_y;
+        const float* angular_velocity_z;
+        const glm::vec4* colors;
+    };
+
+    // Turns the scaled part of a model matrix back into a quaternion, which only works if
+    // the axes are at right angles to each other (which they always are for our cubes).
+    auto get_rotation(const glm::mat4& p_model, const glm::vec3& p_scale) -> glm::vec4 {
+        const auto m = [&](int p_column, int p_row) { return p_model[p_column][p_row] / p_scale[p_column]; };
+
+        // Whichever of these is the largest gives us the most precision to divide by.
+        const auto trace = m(0, 0) + m(1, 1) + m(2, 2);
+
+        if (trace > 0.0f) {
+            const auto s = std::sqrt(trace + 1.0f) * 2.0f;
+            return glm::vec4{(m(1, 2) - m(2, 1)) / s, (m(2, 0) - m(0, 2)) / s, (m(0, 1) - m(1, 0)) / s, 0.25f * s};
+        }
+
+        if (m(0, 0) > m(1, 1) && m(0, 0) > m(2, 2)) {
+            const auto s = std::sqrt(1.0f + m(0, 0) - m(1, 1) - m(2, 2)) * 2.0f;
+            return glm::vec4{0.25f * s, (m(1, 0) + m(0, 1)) / s, (m(2, 0) + m(0, 2)) / s, (m(1, 2) - m(2, 1)) / s};
+        }
+
+        if (m(1, 1) > m(2, 2)) {
+            const auto s = std::sqrt(1.0f + m(1, 1) - m(0, 0) - m(2, 2)) * 2.0f;
+            return glm::vec4{(m(1, 0) + m(0, 1)) / s, 0.25f * s, (m(2, 1) + m(1, 2)) / s, (m(2, 0) - m(0, 2)) / s};
+        }
+
+        const auto s = std::sqrt(1.0f + m(2, 2) - m(0, 0) - m(1, 1)) * 2.0f;
+        return glm::vec4{(m(2, 0) + m(0, 2)) / s, (m(2, 1) + m(1, 2)) / s, 0.25f * s, (m(0, 1) - m(1, 0)) / s};
+    }
+
+    // Both kernels do the same thing. The rotation gets nudged along by the angular
+    // velocity (q += dt / 2 * w * q) and normalized again, which is plenty accurate for
+    // the time steps of a frame, and then the model matrix is built straight out of the
+    // quaternion, the scale and the position.
+    auto update_scalar(const transform_arrays_t& p_arrays, size_t p_begin, size_t p_end, float p_delta_time, bool p_integrate, instance_data_t* p_instances) -> void {
+        const auto half_time = 0.5f * p_delta_time;
+
+        for (auto i = p_begin; i < p_end; i++) {
+            auto x = p_arrays.rotation_x[i];
+            auto y = p_arrays.rotation_y[i];
+            auto z = p_arrays.rotation_z[i];
+            auto w = p_arrays.rotation_w[i];
+
+            if (p_integrate) {
+                const auto velocity_x = p_arrays.angular_velocity_x[i];
+                const auto velocity_y = p_arrays.angular_velocity_y[i];
+                const auto velocity_z = p_arrays.angular_velocity_z[i];
+
+                const auto new_x = x + half_time * (velocity_x * w + velocity_y * z - velocity_z * y);
+                const auto new_y = y + half_time * (velocity_y * w + velocity_z * x - velocity_x * z);
+                const auto new_z = z + half_time * (velocity_z * w + velocity_x * y - velocity_y * x);
+                const auto new_w = w - half_time * (velocity_x * x + velocity_y * y + velocity_z * z);
+
+                const auto inverse_length = 1.0f / std::sqrt(new_x * new_x + new_y * new_y + new_z * new_z + new_w * new_w);
+                x = p_arrays.rotation_x[i] = new_x * inverse_length;
+                y = p_arrays.rotation_y[i] = new_y * inverse_length;
+                z = p_arrays.rotation_z[i] = new_z * inverse_length;
+                w = p_arrays.rotation_w[i] = new_w * inverse_length;
+            }
+
+            const auto scale_x = p_arrays.scale_x[i];
+            const auto scale_y = p_arrays.scale_y[i];
+            const auto scale_z = p_arrays.scale_z[i];
+
+            p_instances[i] = instance_data_t {
+                .model = glm::mat4 {
+                    glm::vec4{scale_x * (1.0f - 2.0f * (y * y + z * z)), scale_x * 2.0f * (x * y + w * z), scale_x * 2.0f * (x * z - w * y), 0.0f},
+                    glm::vec4{scale_y * 2.0f * (x * y - w * z), scale_y * (1.0f - 2.0f * (x * x + z * z)), scale_y * 2.0f * (y * z + w * x), 0.0f},
+                    glm::vec4{scale_z * 2.0f * (x * z + w * y), scale_z * 2.0f * (y * z - w * x), scale_z * (1.0f - 2.0f * (x * x + y * y)), 0.0f},
+                    glm::vec4{p_arrays.position_x[i], p_arrays.position_y[i], p_arrays.position_z[i], 1.0f},
+                },
+                .color = p_arrays.colors[i],
+            };
+        }
+    }
+
+#ifdef HAS_AVX2_KERNEL
+
+#ifdef _MSC_VER
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2,fma")))
+#endif
+
+    auto supports_avx2() noexcept -> bool {
+#ifdef _MSC_VER
+        std::array<int, 4> registers;
+
+        __cpuid(registers.data(), 0);
+        if (registers[0] < 7) {
+            return false;
+        }
+
+        // The OS has to save the YMM registers too, or else they'd get trashed on every
+        // context switch.
+        __cpuid(registers.data(), 1);
+        const bool has_fma = (registers[2] & (1 << 12)) != 0;
+        const bool has_osxsave = (registers[2] & (1 << 27)) != 0;
+        if (!has_fma || !has_osxsave || (_xgetbv(0) & 6) != 6) {
+            return false;
+        }
+
+        __cpuidex(registers.data(), 7, 0);
+        return (registers[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+    }
+
+    // Takes the x, y, z and w of one column for eight instances, and writes it into each
+    // of them. Swapping rows and columns four lanes at a time gives us a whole column of
+    // a single instance in every register.
+    AVX2_TARGET auto store_column(instance_data_t* p_instances, int p_column, __m256 p_x, __m256 p_y, __m256 p_z, __m256 p_w) -> void {
+        for (int half = 0; half < 2; half++) {
+            auto x = half == 0 ? _mm256_castps256_ps128(p_x) : _mm256_extractf128_ps(p_x, 1);
+            auto y = half == 0 ? _mm256_castps256_ps128(p_y) : _mm256_extractf128_ps(p_y, 1);
+            auto z = half == 0 ? _mm256_castps256_ps128(p_z) : _mm256_extractf128_ps(p_z, 1);
+            auto w = half == 0 ? _mm256_castps256_ps128(p_w) : _mm256_extractf128_ps(p_w, 1);
+
+            _MM_TRANSPOSE4_PS(x, y, z, w);
+
+            auto* instances = p_instances + half * 4;
+            _mm_storeu_ps(&instances[0].model[p_column][0], x);
+            _mm_storeu_ps(&instances[1].model[p_column][0], y);
+            _mm_storeu_ps(&instances[2].model[p_column][0], z);
+            _mm_storeu_ps(&instances[3].model[p_column][0], w);
+        }
+    }
+
+    // Eight instances at a time, with whatever is left over going through the scalar
+    // kernel.
+    AVX2_TARGET auto update_avx2(const transform_arrays_t& p_arrays, size_t p_begin, size_t p_end, float p_delta_time, bool p_integrate, instance_data_t* p_instances) -> void {
+        const auto half_time = _mm256_set1_ps(0.5f * p_delta_time);
+        const auto one = _mm256_set1_ps(1.0f);
+        const auto two = _mm256_set1_ps(2.0f);
+        const auto zero = _mm256_setzero_ps();
+
+        auto i = p_begin;
+        for (; i + 8 <= p_end; i += 8) {
+            auto x = _mm256_loadu_ps(p_arrays.rotation_x + i);
+            auto y = _mm256_loadu_ps(p_arrays.rotation_y + i);
+            auto z = _mm256_loadu_ps(p_arrays.rotation_z + i);
+            auto w = _mm256_loadu_ps(p_arrays.rotation_w + i);
+
+            if (p_integrate) {
+                const auto velocity_x = _mm256_loadu_ps(p_arrays.angular_velocity_x + i);
+                const auto velocity_y = _mm256_loadu_ps(p_arrays.angular_velocity_y + i);
+                const auto velocity_z = _mm256_loadu_ps(p_arrays.angular_velocity_z + i);
+
+                const auto delta_x = _mm256_fmsub_ps(velocity_y, z, _mm256_mul_ps(velocity_z, y));
+                const auto delta_y = _mm256_fmsub_ps(velocity_z, x, _mm256_mul_ps(velocity_x, z));
+                const auto delta_z = _mm256_fmsub_ps(velocity_x, y, _mm256_mul_ps(velocity_y, x));
+                const auto delta_w = _mm256_fmadd_ps(velocity_x, x, _mm256_fmadd_ps(velocity_y, y, _mm256_mul_ps(velocity_z, z)));
+
+                const auto new_x = _mm256_fmadd_ps(half_time, _mm256_fmadd_ps(velocity_x, w, delta_x), x);
+                const auto new_y = _mm256_fmadd_ps(half_time, _mm256_fmadd_ps(velocity_y, w, delta_y), y);
+                const auto new_z = _mm256_fmadd_ps(half_time, _mm256_fmadd_ps(velocity_z, w, delta_z), z);
+                const auto new_w = _mm256_fnmadd_ps(half_time, delta_w, w);
+
+                const auto length_squared = _mm256_fmadd_ps(new_x, new_x, _mm256_fmadd_ps(new_y, new_y, _mm256_fmadd_ps(new_z, new_z, _mm256_mul_ps(new_w, new_w))));
+                const auto inverse_length = _mm256_div_ps(one, _mm256_sqrt_ps(length_squared));
+
+                x = _mm256_mul_ps(new_x, inverse_length);
+                y = _mm256_mul_ps(new_y, inverse_length);
+                z = _mm256_mul_ps(new_z, inverse_length);
+                w = _mm256_mul_ps(new_w, inverse_length);
+
+                _mm256_storeu_ps(p_arrays.rotation_x + i, x);
+                _mm256_storeu_ps(p_arrays.rotation_y + i, y);
+                _mm256_storeu_ps(p_arrays.rotation_z + i, z);
+                _mm256_storeu_ps(p_arrays.rotation_w + i, w);
+            }
+
+            const auto xx = _mm256_mul_ps(x, x);
+            const auto yy = _mm256_mul_ps(y, y);
+            const auto zz = _mm256_mul_ps(z, z);
+            const auto xy = _mm256_mul_ps(x, y);
+            const auto xz = _mm256_mul_ps(x, z);
+            const auto yz = _mm256_mul_ps(y, z);
+            const auto wx = _mm256_mul_ps(w, x);
+            const auto wy = _mm256_mul_ps(w, y);
+            const auto wz = _mm256_mul_ps(w, z);
+
+            const auto scale_x = _mm256_loadu_ps(p_arrays.scale_x + i);
+            const auto scale_y = _mm256_loadu_ps(p_arrays.scale_y + i);
+            const auto scale_z = _mm256_loadu_ps(p_arrays.scale_z + i);
+
+            const auto scale_x_2 = _mm256_mul_ps(scale_x, two);
+            const auto scale_y_2 = _mm256_mul_ps(scale_y, two);
+            const auto scale_z_2 = _mm256_mul_ps(scale_z, two);
+
+            auto* instances = p_instances + i;
+
+            store_column(
+                instances, 0,
+                _mm256_fnmadd_ps(scale_x_2, _mm256_add_ps(yy, zz), scale_x),
+                _mm256_mul_ps(scale_x_2, _mm256_add_ps(xy, wz)),
+                _mm256_mul_ps(scale_x_2, _mm256_sub_ps(xz, wy)),
+                zero
+            );
+
+            store_column(
+                instances, 1,
+                _mm256_mul_ps(scale_y_2, _mm256_sub_ps(xy, wz)),
+                _mm256_fnmadd_ps(scale_y_2, _mm256_add_ps(xx, zz), scale_y),
+                _mm256_mul_ps(scale_y_2, _mm256_add_ps(yz, wx)),
+                zero
+            );
+
+            store_column(
+                instances, 2,
+                _mm256_mul_ps(scale_z_2, _mm256_add_ps(xz, wy)),
+                _mm256_mul_ps(scale_z_2, _mm256_sub_ps(yz, wx)),
+                _mm256_fnmadd_ps(scale_z_2, _mm256_add_ps(xx, yy), scale_z),
+                zero
+            );
+
+            store_column(
+                instances, 3,
+                _mm256_loadu_ps(p_arrays.position_x + i),
+                _mm256_loadu_ps(p_arrays.position_y + i),
+                _mm256_loadu_ps(p_arrays.position_z + i),
+                one
+            );
+
+            for (int lane = 0; lane < 8; lane++) {
+                _mm_storeu_ps(&instances[lane].color[0], _mm_loadu_ps(&p_arrays.colors[i + lane][0]));
+            }
+        }
+
+        update_scalar(p_arrays, i, p_end, p_delta_time, p_integrate, p_instances);
+    }
+
+    const bool use_avx2 = supports_avx2();
+
+#endif
+
+    auto update_range(const transform_arrays_t& p_arrays, size_t p_begin, size_t p_end, float p_delta_time, bool p_integrate, instance_data_t* p_instances) -> void {
+#ifdef HAS_AVX2_KERNEL
+        if (use_avx2) {
+            update_avx2(p_arrays, p_begin, p_end, p_delta_time, p_integrate, p_instances);
+            return;
+        }
+#endif
+
+        update_scalar(p_arrays, p_begin, p_end, p_delta_time, p_integrate, p_instances);
+    }
+}
+
+transform_store_t::transform_store_t(std::span<const instance_data_t> p_instances, uint32_t p_frame_count) :
+    m_count(static_cast<uint32_t>(p_instances.size())),
+    m_position_x(m_count), m_position_y(m_count), m_position_z(m_count),
+    m_rotation_x(m_count), m_rotation_y(m_count), m_rotation_z(m_count), m_rotation_w(m_count),
+    m_scale_x(m_count), m_scale_y(m_count), m_scale_z(m_count),
+    m_angular_velocity_x(m_count, 0.0f), m_angular_velocity_y(m_count, 0.0f), m_angular_velocity_z(m_count, 0.0f),
+    m_colors(m_count),
+    m_spinning_counts((m_count + chunk_size - 1) / chunk_size, 0),
+    // Everything is missing from every copy to begin with, so the first update of each
+    // frame writes all of it.
+    m_chunk_changes(m_spinning_counts.size(), 1),
+    m_frame_updates(p_frame_count, 0),
+    m_update(0)
+{
+    for (uint32_t i = 0; i < m_count; i++) {
+        const auto& model = p_instances[i].model;
+
+        const glm::vec3 scale{
+            glm::length(glm::vec3{model[0][0], model[0][1], model[0][2]}),
+            glm::length(glm::vec3{model[1][0], model[1][1], model[1][2]}),
+            glm::length(glm::vec3{model[2][0], model[2][1], model[2][2]}),
+        };
+
+        const auto rotation = get_rotation(model, scale);
+
+        m_position_x[i] = model[3][0];
+        m_position_y[i] = model[3][1];
+        m_position_z[i] = model[3][2];
+        m_rotation_x[i] = rotation.x;
+        m_rotation_y[i] = rotation.y;
+        m_rotation_z[i] = rotation.z;
+        m_rotation_w[i] = rotation.w;
+        m_scale_x[i] = scale.x;
+        m_scale_y[i] = scale.y;
+        m_scale_z[i] = scale.z;
+        m_colors[i] = p_instances[i].color;
+    }
+}
+
+auto transform_store_t::mark_changed(uint32_t p_index) noexcept -> void {
+    // Shows up in the next update.
+    m_chunk_changes[p_index / chunk_size] = m_update + 1;
+}
+
+auto transform_store_t::set_position(uint32_t p_index, const glm::vec3& p_position) noexcept -> void {
+    m_position_x[p_index] = p_position.x;
+    m_position_y[p_index] = p_position.y;
+    m_position_z[p_index] = p_position.z;
+    mark_changed(p_index);
+}
+
+auto transform_store_t::set_rotation(uint32_t p_index, const glm::vec4& p_rotation) noexcept -> void {
+    m_rotation_x[p_index] = p_rotation.x;
+    m_rotation_y[p_index] = p_rotation.y;
+    m_rotation_z[p_index] = p_rotation.z;
+    m_rotation_w[p_index] = p_rotation.w;
+    mark_changed(p_index);
+}
+
+auto transform_store_t::set_scale(uint32_t p_index, const glm::vec3& p_scale) noexcept -> void {
+    m_scale_x[p_index] = p_scale.x;
+    m_scale_y[p_index] = p_scale.y;
+    m_scale_z[p_index] = p_scale.z;
+    mark_changed(p_index);
+}
+
+auto transform_store_t::set_angular_velocity(uint32_t p_index, const glm::vec3& p_angular_velocity) noexcept -> void {
+    const bool was_spinning = m_angular_velocity_x[p_index] != 0.0f || m_angular_velocity_y[p_index] != 0.0f || m_angular_velocity_z[p_index] != 0.0f;
+    const bool is_spinning = p_angular_velocity.x != 0.0f || p_angular_velocity.y != 0.0f || p_angular_velocity.z != 0.0f;
+
+    auto& spinning_count = m_spinning_counts[p_index / chunk_size];
+    if (is_spinning && !was_spinning) {
+        spinning_count++;
+    } else if (!is_spinning && was_spinning) {
+        spinning_count--;
+    }
+
+    m_angular_velocity_x[p_index] = p_angular_velocity.x;
+    m_angular_velocity_y[p_index] = p_angular_velocity.y;
+    m_angular_velocity_z[p_index] = p_angular_velocity.z;
+}
+
+auto transform_store_t::update(float p_delta_time, uint32_t p_frame_index, instance_data_t* p_instances, job_system_t& p_jobs) -> void {
+    m_update++;
+
+    const transform_arrays_t arrays {
+        .position_x = m_position_x.data(),
+        .position_y = m_position_y.data(),
+        .position_z = m_position_z.data(),
+        .rotation_x = m_rotation_x.data(),
+        .rotation_y = m_rotation_y.data(),
+        .rotation_z = m_rotation_z.data(),
+        .rotation_w = m_rotation_w.data(),
+        .scale_x = m_scale_x.data(),
+        .scale_y = m_scale_y.data(),
+        .scale_z = m_scale_z.data(),
+        .angular_velocity_x = m_angular_velocity_x.data(),
+        .angular_velocity_y = m_angular_velocity_y.data(),
+        .angular_velocity_z = m_angular_velocity_z.data(),
+        .colors = m_colors.data(),
+    };
+
+    const auto last_written = m_frame_updates[p_frame_index];
+
+    // Every job has a chunk to itself, so nothing that they touch is shared.
+    p_jobs.parallel_for(m_spinning_counts.size(), 1, [&](size_t p_chunk, size_t) {
+        const bool spinning = m_spinning_counts[p_chunk] > 0;
+        if (spinning) {
+            m_chunk_changes[p_chunk] = m_update;
+        }
+
+        if (m_chunk_changes[p_chunk] <= last_written) {
+            return;
+        }
+
+        const auto begin = p_chunk * chunk_size;
+        const auto end = std::min<size_t>(begin + chunk_size, m_count);
+        update_range(arrays, begin, end, p_delta_time, spinning, p_instances);
+    });
+
+    m_frame_updates[p_frame_index] = m_update;
+}
+
+auto transform_store_t::get_kernel_name() noexcept -> std::string_view {
+#ifdef HAS_AVX2_KERNEL
+    if (use_avx2) {
+        return "AVX2";
+    }
+#endif
+
+    return "scalar";
+}
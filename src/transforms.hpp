@@ -0,0 +1,68 @@
+#pragma once
+
+#include "common.hpp"
+#include "buffers.hpp"
+#include "jobs.hpp"
+
+namespace pooper_cube {
+    // The transforms of every cube, kept as a structure of arrays so that a batch of them
+    // can be loaded straight into SIMD registers. Every update spins the cubes by their
+    // angular velocity, and writes the ones that changed into the copy of the instance
+    // buffer that belongs to the frame being recorded, as finished model matrices.
+    //
+    // Changes are tracked per chunk of cubes. Each frame's copy remembers which update it
+    // was last written by, so a chunk only gets written into it again if it changed since
+    // then. Cubes that don't spin cost nothing once every copy has caught up.
+    class transform_store_t {
+        public:
+            // Splits every model matrix back up into a position, rotation and scale. Nothing
+            // spins to begin with.
+            transform_store_t(std::span<const instance_data_t> instances, uint32_t frame_count);
+            NO_COPY(transform_store_t);
+
+            auto set_position(uint32_t index, const glm::vec3& position) noexcept -> void;
+
+            // The rotation is a unit quaternion, with the real part last.
+            auto set_rotation(uint32_t index, const glm::vec4& rotation) noexcept -> void;
+            auto set_scale(uint32_t index, const glm::vec3& scale) noexcept -> void;
+
+            // In radians per second, around the axis that the vector points along.
+            auto set_angular_velocity(uint32_t index, const glm::vec3& angular_velocity) noexcept -> void;
+
+            // Spins every cube by p_delta_time seconds, and writes everything that the frame's
+            // copy is missing into p_instances, which must have room for every cube. The
+            // chunks are spread over the job system.
+            auto update(float delta_time, uint32_t frame_index, instance_data_t* instances, job_system_t& jobs) -> void;
+
+            auto get_count() const noexcept -> uint32_t { return m_count; }
+
+            // Which of the kernels update() ends up using on this CPU.
+            static auto get_kernel_name() noexcept -> std::string_view;
+
+        private:
+            // Big enough that the jobs are worth handing out.
+            static constexpr uint32_t chunk_size = 4096;
+
+            auto mark_changed(uint32_t index) noexcept -> void;
+
+            uint32_t m_count;
+
+            std::vector<float> m_position_x, m_position_y, m_position_z;
+            std::vector<float> m_rotation_x, m_rotation_y, m_rotation_z, m_rotation_w;
+            std::vector<float> m_scale_x, m_scale_y, m_scale_z;
+            std::vector<float> m_angular_velocity_x, m_angular_velocity_y, m_angular_velocity_z;
+
+            // Never changes, but has to be written along with the matrices, so that whole
+            // instances get written out one after the other.
+            std::vector<glm::vec4> m_colors;
+
+            // How many cubes of each chunk have a non-zero angular velocity.
+            std::vector<uint32_t> m_spinning_counts;
+
+            // The update that last changed each chunk, and the update that each frame's copy
+            // was last written by.
+            std::vector<uint64_t> m_chunk_changes;
+            std::vector<uint64_t> m_frame_updates;
+            uint64_t m_update;
+    };
+}
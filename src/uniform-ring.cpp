@@ -0,0 +1,42 @@
+#include "uniform-ring.hpp"
+
+using pooper_cube::uniform_ring_t;
+
+namespace {
+    auto get_uniform_alignment(const pooper_cube::physical_device_t& p_physical_device) -> VkDeviceSize {
+        VkPhysicalDeviceProperties device_properties;
+        vkGetPhysicalDeviceProperties(p_physical_device, &device_properties);
+
+        return device_properties.limits.minUniformBufferOffsetAlignment;
+    }
+
+    auto align_up(VkDeviceSize p_value, VkDeviceSize p_alignment) -> VkDeviceSize {
+        return (p_value + p_alignment - 1) / p_alignment * p_alignment;
+    }
+}
+
+uniform_ring_t::uniform_ring_t(allocator_t& p_allocator, uint32_t p_frame_count, VkDeviceSize p_frame_size) :
+    m_alignment(get_uniform_alignment(p_allocator.get_physical_device())),
+    // Every region has to start on an aligned offset too.
+    m_frame_size(align_up(p_frame_size, m_alignment)),
+    m_buffer(p_allocator, buffer_t::type_t::uniform, m_frame_size * p_frame_count),
+    m_data(static_cast<std::byte*>(static_cast<void*>(m_buffer.map_memory()))),
+    m_head(0),
+    m_frame_end(m_frame_size)
+{}
+
+auto uniform_ring_t::begin_frame(uint32_t p_frame_index) noexcept -> void {
+    m_head = p_frame_index * m_frame_size;
+    m_frame_end = m_head + m_frame_size;
+}
+
+auto uniform_ring_t::allocate(VkDeviceSize p_size) -> uint32_t {
+    const auto offset = m_head;
+
+    if (offset + p_size > m_frame_end) {
+        throw generic_vulkan_exception_t{VK_ERROR_OUT_OF_DEVICE_MEMORY, "A frame ran out of room in the uniform ring."};
+    }
+
+    m_head = align_up(offset + p_size, m_alignment);
+    return static_cast<uint32_t>(offset);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "common.hpp"
+#include "buffers.hpp"
+#include "memory.hpp"
+
+namespace pooper_cube {
+    // One big persistently mapped uniform buffer, split up into a region for every frame in
+    // flight. Each frame hands out slices of its own region, so the CPU never writes to
+    // memory that the GPU might still be reading, and nobody needs a buffer of their own
+    // just for some constants. The slices get pushed as descriptors, or bound with dynamic
+    // offsets without push descriptors.
+    class uniform_ring_t {
+        public:
+            uniform_ring_t(allocator_t& allocator, uint32_t frame_count, VkDeviceSize frame_size);
+            NO_COPY(uniform_ring_t);
+
+            operator VkBuffer() const noexcept { return m_buffer; }
+
+            // Starts handing out slices from the beginning of the frame's region again. Must
+            // only be called once the GPU is done with everything from the frame's last
+            // submission.
+            auto begin_frame(uint32_t frame_index) noexcept -> void;
+
+            // Returns the offset of a slice that is at least p_size bytes long, aligned for
+            // use as the offset of a uniform buffer descriptor, or as a dynamic offset. Not
+            // thread safe.
+            auto allocate(VkDeviceSize size) -> uint32_t;
+
+            // Copies the value into a fresh slice and returns its offset.
+            template<typename T>
+            auto push(const T& p_value) -> uint32_t {
+                const auto offset = allocate(sizeof(T));
+                std::memcpy(m_data + offset, &p_value, sizeof(T));
+                return offset;
+            }
+
+        private:
+            VkDeviceSize m_alignment;
+            VkDeviceSize m_frame_size;
+
+            host_coherent_buffer_t m_buffer;
+            std::byte* m_data;
+
+            VkDeviceSize m_head;
+            VkDeviceSize m_frame_end;
+    };
+}
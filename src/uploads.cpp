@@ -0,0 +1,131 @@
+#include "uploads.hpp"
+
+using pooper_cube::upload_manager_t;
+
+upload_manager_t::upload_manager_t(allocator_t& p_allocator, submission_tracker_t& p_submissions) :
+    m_allocator(p_allocator),
+    m_submissions(p_submissions),
+    m_device(p_allocator.get_device()),
+    m_command_pool(m_device, p_allocator.get_physical_device().transfer_queue_family),
+    m_last_ticket{queue_kind_t::transfer, 0}
+{}
+
+auto upload_manager_t::upload(const buffer_t& p_destination, std::span<const std::byte> p_data, VkDeviceSize p_destination_offset) -> void {
+    const std::lock_guard lock{m_mutex};
+
+    if (m_current_batch == nullptr) {
+        collect();
+
+        if (!m_free_batches.empty()) {
+            m_current_batch = std::move(m_free_batches.back());
+            m_free_batches.pop_back();
+
+            const auto result = vkResetCommandBuffer(m_current_batch->command_buffer, 0);
+            if (result != VK_SUCCESS) {
+                throw generic_vulkan_exception_t{result, "Failed to reset an upload command buffer."};
+            }
+        } else {
+            m_current_batch = std::make_unique<batch_t>(m_command_pool.allocate_command_buffer());
+        }
+
+        const VkCommandBufferBeginInfo begin_info {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .pNext = nullptr,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            .pInheritanceInfo = nullptr,
+        };
+
+        const auto result = vkBeginCommandBuffer(m_current_batch->command_buffer, &begin_info);
+        if (result != VK_SUCCESS) {
+            throw generic_vulkan_exception_t{result, "Failed to begin recording an upload command buffer."};
+        }
+    }
+
+    auto& staging_buffer = m_current_batch->staging_buffers.emplace_back(
+        std::make_unique<host_coherent_buffer_t>(m_allocator, buffer_t::type_t::staging, p_data.size())
+    );
+
+    {
+        const auto memory = staging_buffer->map_memory();
+        std::memcpy(memory, p_data.data(), p_data.size());
+    }
+
+    const VkBufferCopy buffer_copy {
+        .srcOffset = 0,
+        .dstOffset = p_destination_offset,
+        .size = p_data.size(),
+    };
+
+    vkCmdCopyBuffer(m_current_batch->command_buffer, *staging_buffer, p_destination, 1, &buffer_copy);
+}
+
+auto upload_manager_t::submit() -> upload_ticket_t {
+    const std::lock_guard lock{m_mutex};
+
+    // Nothing to do, so whatever was submitted last is what the caller has to wait for.
+    if (m_current_batch == nullptr) {
+        return m_last_ticket;
+    }
+
+    const auto result = vkEndCommandBuffer(m_current_batch->command_buffer);
+    if (result != VK_SUCCESS) {
+        throw generic_vulkan_exception_t{result, "Failed to end recording an upload command buffer."};
+    }
+
+    const std::array<VkCommandBuffer, 1> command_buffers{m_current_batch->command_buffer};
+    m_current_batch->ticket = m_submissions.submit(queue_kind_t::transfer, command_buffers);
+    m_last_ticket = m_current_batch->ticket;
+    m_submitted_batches.push_back(std::move(m_current_batch));
+
+    return m_last_ticket;
+}
+
+auto upload_manager_t::collect() -> void {
+    // Batches are submitted to a single queue, so they finish in order and we can stop
+    // looking at the first one that is still running.
+    while (!m_submitted_batches.empty()) {
+        auto& batch = m_submitted_batches.front();
+        if (!m_submissions.is_retired(batch->ticket)) {
+            break;
+        }
+
+        batch->staging_buffers.clear();
+        m_free_batches.push_back(std::move(batch));
+        m_submitted_batches.pop_front();
+    }
+}
+
+auto upload_manager_t::is_complete(upload_ticket_t p_ticket) -> bool {
+    // Asking the tracker is cheap, the lock is only needed to recycle the batches.
+    if (!m_submissions.is_retired(p_ticket)) {
+        return false;
+    }
+
+    const std::lock_guard lock{m_mutex};
+    collect();
+
+    return true;
+}
+
+auto upload_manager_t::wait(upload_ticket_t p_ticket) -> void {
+    m_submissions.wait(p_ticket);
+
+    const std::lock_guard lock{m_mutex};
+    collect();
+}
+
+upload_manager_t::~upload_manager_t() noexcept {
+    // The staging buffers (and the command buffers) can't go away while the GPU is still
+    // copying out of them.
+    if (!m_submitted_batches.empty()) {
+        try {
+            m_submissions.wait(m_submitted_batches.back()->ticket);
+        } catch (...) {
+            // Most likely, the device got lost, in which case there's nothing left to
+            // wait for anyway.
+        }
+    }
+
+    // A batch that was recorded but never submitted doesn't have to be waited for.
+    m_current_batch.reset();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include "common.hpp"
+#include "buffers.hpp"
+#include "commands.hpp"
+#include "memory.hpp"
+#include "submissions.hpp"
+
+namespace pooper_cube {
+    // Identifies a batch of uploads. It's just the submission to the transfer queue, so it
+    // can also be handed to another queue to wait on. Tickets are handed out in submission
+    // order, so once a ticket is complete, every ticket before it is complete as well.
+    using upload_ticket_t = submission_t;
+
+    // Collects copies into device local buffers and submits them in batches on the transfer
+    // queue, so that nobody has to wait for the queue to go idle after every single copy.
+    class upload_manager_t {
+        public:
+            upload_manager_t(allocator_t& allocator, submission_tracker_t& submissions);
+            NO_COPY(upload_manager_t);
+
+            // Copies the data into a staging buffer right away, and records the copy into the
+            // destination into the current batch. Nothing is sent to the GPU until submit().
+            auto upload(const buffer_t& destination, std::span<const std::byte> data, VkDeviceSize destination_offset = 0) -> void;
+
+            // Sends off the current batch. The returned ticket can be used to find out when
+            // the copies are done.
+            auto submit() -> upload_ticket_t;
+
+            // Doesn't block.
+            auto is_complete(upload_ticket_t ticket) -> bool;
+
+            auto wait(upload_ticket_t ticket) -> void;
+
+            ~upload_manager_t() noexcept;
+
+        private:
+            struct batch_t {
+                batch_t(VkCommandBuffer p_command_buffer) :
+                    command_buffer(p_command_buffer), ticket{queue_kind_t::transfer, 0} {}
+
+                VkCommandBuffer command_buffer;
+                upload_ticket_t ticket;
+
+                // Kept alive until the GPU is done copying out of them.
+                std::vector<std::unique_ptr<host_coherent_buffer_t>> staging_buffers;
+            };
+
+            // Recycles the batches that the GPU has finished. The mutex must be held.
+            auto collect() -> void;
+
+            allocator_t& m_allocator;
+            submission_tracker_t& m_submissions;
+            const device_t& m_device;
+
+            command_pool_t m_command_pool;
+
+            std::mutex m_mutex;
+
+            std::unique_ptr<batch_t> m_current_batch;
+            std::deque<std::unique_ptr<batch_t>> m_submitted_batches;
+            std::vector<std::unique_ptr<batch_t>> m_free_batches;
+
+            // What the last batch was, so that submitting nothing has something to return.
+            upload_ticket_t m_last_ticket;
+    };
+}
@@ -6,7 +6,7 @@
 
 using pooper_cube::instance_t;
 
-instance_t::instance_t(bool p_enable_validation) {
+instance_t::instance_t(bool p_enable_validation, bool p_enable_presentation) {
     const VkApplicationInfo application_info {
         .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
         .pNext = nullptr,
@@ -14,9 +14,14 @@ instance_t::instance_t(bool p_enable_validation) {
         .apiVersion = VK_API_VERSION_1_3,
     };
 
-    uint32_t glfw_extension_count = 0;
-    const auto glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
-    std::vector<const char*> enabled_extensions(glfw_extensions, glfw_extensions + glfw_extension_count);
+    std::vector<const char*> enabled_extensions;
+
+    if (p_enable_presentation) {
+        uint32_t glfw_extension_count = 0;
+        const auto glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+        enabled_extensions.assign(glfw_extensions, glfw_extensions + glfw_extension_count);
+    }
+
     std::vector<const char*> enabled_layers;
     const void* next_pointer = nullptr;
 
@@ -4,7 +4,9 @@ namespace pooper_cube {
     struct instance_t {
         VkInstance handle;
         
-        instance_t(bool p_enable_validation = false); 
+        // When p_enable_presentation is false, GLFW does not have to be initialized, and
+        // the instance can only be used for headless rendering.
+        instance_t(bool p_enable_validation = false, bool p_enable_presentation = true); 
         
         instance_t(const instance_t&) = delete;
         auto operator=(const instance_t&) -> instance_t& = delete;
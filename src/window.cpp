@@ -10,7 +10,7 @@ namespace {
     }
 }
 
-window_t::window_t(uint16_t p_width, uint16_t p_height, std::string_view p_title) {
+window_t::window_t(uint16_t p_width, uint16_t p_height, std::string_view p_title) : m_resize_pending(false) {
     if (!glfwInit()) {
         throw creation_exception_t::glfw_init_failed;
     }
@@ -26,6 +26,27 @@ window_t::window_t(uint16_t p_width, uint16_t p_height, std::string_view p_title
         glfwTerminate();
         throw creation_exception_t::window_creation_failed;
     }
+
+    // The window can't be moved around (it isn't copyable, and nothing moves it), so the
+    // pointer stays valid for as long as the GLFW window exists.
+    glfwSetWindowUserPointer(m_window, this);
+    glfwSetFramebufferSizeCallback(m_window, framebuffer_size_callback);
+}
+
+auto window_t::framebuffer_size_callback(GLFWwindow* p_window, int, int) -> void {
+    auto& window = *static_cast<window_t*>(glfwGetWindowUserPointer(p_window));
+
+    window.m_resize_pending = true;
+    window.m_last_resize = std::chrono::steady_clock::now();
+}
+
+auto window_t::take_settled_resize(std::chrono::steady_clock::duration p_settle_time) noexcept -> bool {
+    if (!m_resize_pending || std::chrono::steady_clock::now() - m_last_resize < p_settle_time) {
+        return false;
+    }
+
+    m_resize_pending = false;
+    return true;
 }
 
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+
 namespace pooper_cube {
     // A thin wrapper around a GLFW window, specifically made for this project
     class window_t {
@@ -66,12 +68,42 @@ namespace pooper_cube {
                 glfwPollEvents();
             }
 
+            // Sleeps until there is at least one event (or the timeout, in seconds, runs
+            // out), then handles all of them.
+            auto wait_events(double timeout) const noexcept -> void {
+                glfwWaitEventsTimeout(timeout);
+            }
+
+            // Minimized, that is.
+            auto is_iconified() const noexcept -> bool {
+                return glfwGetWindowAttrib(m_window, GLFW_ICONIFIED) == GLFW_TRUE;
+            }
+
+            auto is_focused() const noexcept -> bool {
+                return glfwGetWindowAttrib(m_window, GLFW_FOCUSED) == GLFW_TRUE;
+            }
+
+            // Returns true once the framebuffer has been resized and then left alone for
+            // the given amount of time, and false again until the next resize. Dragging the
+            // edge of a window around resizes it many times a second, and there's no point
+            // to keeping up with every single one of those.
+            auto take_settled_resize(std::chrono::steady_clock::duration settle_time) noexcept -> bool;
+
+            // Whether the framebuffer has been resized since the last time that a settled
+            // resize was taken.
+            auto is_resize_pending() const noexcept -> bool { return m_resize_pending; }
+
             ~window_t() {
                 glfwDestroyWindow(m_window);
                 glfwTerminate();
             }
 
         private:
+            static auto framebuffer_size_callback(GLFWwindow* window, int width, int height) -> void;
+
             GLFWwindow* m_window;
+
+            bool m_resize_pending;
+            std::chrono::steady_clock::time_point m_last_resize;
     };
 }